@@ -0,0 +1,152 @@
+// the allocation benchmark of the sql text formatting,compile it on linux system with :
+// g++ -std=c++11 -O2 -lpthread -ldl bench_format.cpp -o bench_format.exe -I .. -l sqlite3
+// usage : bench_format.exe [calls per run]
+//
+// the global operator new is replaced by a counting one,and every run prints the heap allocations and
+// the time of a call of :
+//   legacy       : vsnprintf(nullptr) to measure the text and vsprintf into a std::string,the formatting
+//                  of the connections before format_buffer
+//   format       : zdb2::format_buffer,which is used by the connections now
+//   execute      : sqlite_connection::execute with a typical insert statement
+//   query        : sqlite_connection::query with a typical select statement,the resultset it returns is
+//                  the only allocation
+//   prepare_stmt : sqlite_connection::prepare_stmt of a statement which is in the statement cache
+// a sqlite in memory database is used,sqlite allocates by its own malloc,which is not counted.
+// the exit code is 0 if the formatting allocates nothing in all the calls except legacy.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdarg>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <zdb2/zdb.hpp>
+
+static std::atomic<std::uint64_t> g_allocations{ 0 };
+
+void * operator new(std::size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	void * p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void * p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+/// the formatting of the connections before format_buffer
+static std::string legacy_format(const char * fmt, ...)
+{
+	va_list ap, ap_copy;
+	va_start(ap, fmt);
+
+	va_copy(ap_copy, ap);
+	int len = std::vsnprintf(nullptr, 0, fmt, ap_copy);
+	va_end(ap_copy);
+
+	std::string s;
+	if (len > 0)
+	{
+		s.resize(len + 1);
+		std::vsprintf((char*)s.data(), fmt, ap);
+		s.resize(len);
+	}
+
+	va_end(ap);
+	return s;
+}
+
+static const char * INSERT_SQL = "insert into bench_format(id,name,score) values(%d,'%s',%f)";
+static const char * SELECT_SQL = "select id,name,score from bench_format where id=%d and name='%s'";
+static const char * PREPARE_SQL = "update bench_format set score=? where id=? and name like '%s%%'";
+
+/// @return the allocations per call
+template<class Function>
+double run(const char * name, std::size_t calls, Function && f)
+{
+	// warm up,so the first use of the statement cache and the sqlite internals is not counted
+	for (std::size_t i = 0; i < 16; i++)
+		f(i);
+
+	std::uint64_t allocations = g_allocations.load();
+	auto begin = std::chrono::steady_clock::now();
+
+	for (std::size_t i = 0; i < calls; i++)
+		f(i);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	allocations = g_allocations.load() - allocations;
+
+	std::printf("%-12s %8.2f allocations/call %10.0f ns/call\n", name,
+		(double)allocations / (double)calls, elapsed * 1e9 / (double)calls);
+
+	return (double)allocations / (double)calls;
+}
+
+int main(int argc, char *argv[])
+{
+	std::size_t calls = (argc > 1 ? (std::size_t)std::atoi(argv[1]) : 100000);
+	if (calls < 1)
+		calls = 1;
+
+	std::shared_ptr<zdb2::url> url_ptr = std::make_shared<zdb2::url>("sqlite://:memory:?synchronous=off");
+	std::shared_ptr<zdb2::pool> pool_ptr = std::make_shared<zdb2::pool>(url_ptr, 1, 30, 3000, 1);
+	std::shared_ptr<zdb2::connection> conn = pool_ptr->get();
+
+	conn->execute("create table bench_format(id integer primary key, name text, score real)");
+
+	std::printf("%u calls per run,sql text of about %u characters\n", (unsigned)calls,
+		(unsigned)legacy_format(INSERT_SQL, 1, "the name of the row", 0.5).size());
+
+	volatile std::size_t sink = 0;
+	int failed = 0;
+
+	run("legacy", calls, [&](std::size_t i)
+	{
+		std::string s = legacy_format(INSERT_SQL, (int)i, "the name of the row", 0.5);
+		sink = sink + s.size();
+	});
+
+	failed += (run("format", calls, [&](std::size_t i)
+	{
+		zdb2::format_buffer str;
+		str.format(INSERT_SQL, (int)i, "the name of the row", 0.5);
+		sink = sink + str.size();
+	}) > 0);
+
+	failed += (run("execute", calls, [&](std::size_t i)
+	{
+		conn->execute(INSERT_SQL, (int)(i + 1000), "the name of the row", 0.5);
+	}) > 0);
+
+	// the resultset is allocated by every query
+	failed += (run("query", calls, [&](std::size_t i)
+	{
+		std::shared_ptr<zdb2::resultset> rs = conn->query(SELECT_SQL, (int)(i % 1000 + 1000), "the name of the row");
+		sink = sink + (rs ? 1 : 0);
+	}) > 1);
+
+	failed += (run("prepare_stmt", calls, [&](std::size_t)
+	{
+		std::shared_ptr<zdb2::stmt> s = conn->prepare_stmt(PREPARE_SQL, "the name");
+		sink = sink + (s ? 1 : 0);
+	}) > 0);
+
+	conn.reset();
+	pool_ptr.reset();
+
+	std::printf("%s\n", failed ? "FAILED" : "OK");
+	return (failed ? 1 : 0);
+};
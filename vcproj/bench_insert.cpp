@@ -0,0 +1,111 @@
+// the bulk insert benchmark,compile it on linux system with :
+// g++ -std=c++11 -O2 -lpthread -ldl bench_insert.cpp -o bench_insert.exe -I .. -l sqlite3 -l mysqlclient
+// usage : bench_insert.exe [rows] [url]
+//
+// inserts the rows of (integer,text,real) into a empty table and prints the rows per second of :
+//   loop          : conn->exec for every row in autocommit mode,every row is a transaction,so only
+//                   a part of the rows is inserted by it
+//   loop_tx       : conn->exec for every row in one transaction
+//   execute_batch : one prepared statement executed for every row by stmt::execute_batch,in one transaction
+//   insert_many   : connection::insert_many,which is a transaction of multi-row statements on MySQL
+// the default url is a sqlite database file in the current directory.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <zdb2/zdb.hpp>
+
+typedef std::tuple<int, std::string, double> row_type;
+
+static const char * INSERT_SQL = "insert into bench_insert(id,name,score) values(?,?,?)";
+
+static void create_table(std::shared_ptr<zdb2::connection> & conn)
+{
+	conn->execute("drop table if exists bench_insert");
+	conn->execute("create table bench_insert(id integer, name varchar(64), score double)");
+}
+
+/// @param base The rows per second of the loop,the run is compared with it
+/// @return the rows per second
+template<class Function>
+double run(const char * name, std::shared_ptr<zdb2::connection> & conn, const std::vector<row_type> & rows,
+	double base, Function && f)
+{
+	create_table(conn);
+
+	auto begin = std::chrono::steady_clock::now();
+
+	f(rows);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	std::shared_ptr<zdb2::resultset> rs = conn->query("select count(*) from bench_insert");
+	int64_t count = (rs && rs->next_row() ? rs->get_int64(0) : -1);
+	rs.reset();
+
+	double rate = (double)rows.size() / elapsed;
+	std::printf("%-14s %8u rows %12.0f rows/s %8.1fx of loop%s\n", name, (unsigned)rows.size(), rate,
+		(base > 0 ? rate / base : 1.0), (count == (int64_t)rows.size() ? "" : "   the count of the rows is wrong"));
+	return rate;
+}
+
+int main(int argc, char *argv[])
+{
+	std::size_t count = (argc > 1 ? (std::size_t)std::atoi(argv[1]) : 100000);
+	const char * url = (argc > 2 ? argv[2] : "sqlite://bench_insert.db3?synchronous=normal");
+	if (count < 1)
+		count = 1;
+
+	std::vector<row_type> rows;
+	rows.reserve(count);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		rows.emplace_back((int)i, "the name of the row number " + std::to_string(i), (double)i * 0.5);
+	}
+
+	// every row of the autocommit loop waits for the disk,so it inserts fewer rows
+	std::vector<row_type> few_rows(rows.begin(), rows.begin() + (count < 1000 ? count : 1000));
+
+	std::shared_ptr<zdb2::url> url_ptr = std::make_shared<zdb2::url>(url);
+	std::shared_ptr<zdb2::pool> pool_ptr = std::make_shared<zdb2::pool>(url_ptr, 1, 30, 3000, 1);
+	std::shared_ptr<zdb2::connection> conn = pool_ptr->get();
+
+	std::printf("%s\n", url);
+
+	double base = run("loop", conn, few_rows, 0, [&](const std::vector<row_type> & r)
+	{
+		for (const auto & row : r)
+			conn->exec(INSERT_SQL, std::get<0>(row), std::get<1>(row), std::get<2>(row));
+	});
+
+	run("loop_tx", conn, rows, base, [&](const std::vector<row_type> & r)
+	{
+		conn->begin_transaction();
+		for (const auto & row : r)
+			conn->exec(INSERT_SQL, std::get<0>(row), std::get<1>(row), std::get<2>(row));
+		conn->commit();
+	});
+
+	run("execute_batch", conn, rows, base, [&](const std::vector<row_type> & r)
+	{
+		conn->begin_transaction();
+		conn->prepare_stmt(INSERT_SQL)->execute_batch(r);
+		conn->commit();
+	});
+
+	run("insert_many", conn, rows, base, [&](const std::vector<row_type> & r)
+	{
+		conn->insert_many("bench_insert", { "id","name","score" }, r);
+	});
+
+	conn->execute("drop table if exists bench_insert");
+	conn.reset();
+	pool_ptr.reset();
+
+	return 0;
+};
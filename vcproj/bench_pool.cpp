@@ -0,0 +1,160 @@
+// the contention benchmark of the pool idle connections list,compile it on linux system with :
+// g++ -std=c++11 -O2 -lpthread bench_pool.cpp -o bench_pool.exe -I ..
+// usage : bench_pool.exe [seconds per run] [idle connections]
+//
+// every thread takes a connection from the idle list and returns it in a loop,like pool::get and the
+// release deleter do,for 1 to 64 threads,and prints the throughput and the p50/p99 latency of a
+// get and release pair of :
+//   deque   : the std::deque guarded by the pool spin_lock,the idle list before the lock free queue
+//   mpmc    : the lock free bounded queue
+//   sharded : the per thread shards,which is used by the pool now
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+#include <zdb2/util/spin_lock.hpp>
+#include <zdb2/util/mpmc_queue.hpp>
+#include <zdb2/util/sharded_queue.hpp>
+#include <zdb2/util/histogram.hpp>
+
+/// a connection,the borrower touches it like a driver call would
+struct fake_connection
+{
+	char buffer[256];
+};
+
+class deque_list
+{
+public:
+	deque_list(std::size_t, std::size_t)
+	{
+	}
+
+	bool try_push(fake_connection * conn)
+	{
+		std::lock_guard<zdb2::spin_lock> g(m_lock);
+		m_connections.push_back(conn);
+		return true;
+	}
+
+	bool try_pop(fake_connection *& conn)
+	{
+		std::lock_guard<zdb2::spin_lock> g(m_lock);
+		if (m_connections.empty())
+			return false;
+		conn = m_connections.front();
+		m_connections.pop_front();
+		return true;
+	}
+
+protected:
+	zdb2::spin_lock m_lock;
+	std::deque<fake_connection *> m_connections;
+};
+
+class mpmc_list : public zdb2::mpmc_queue<fake_connection *>
+{
+public:
+	mpmc_list(std::size_t, std::size_t capacity) : zdb2::mpmc_queue<fake_connection *>(capacity)
+	{
+	}
+};
+
+class sharded_list : public zdb2::sharded_queue<fake_connection *>
+{
+public:
+	sharded_list(std::size_t shards, std::size_t capacity) : zdb2::sharded_queue<fake_connection *>(shards, capacity)
+	{
+	}
+};
+
+template<class List>
+void run(const char * name, std::size_t threads, std::size_t idle_count, double seconds)
+{
+	// one shard per hardware thread capped at the connections count,like the pool default
+	std::size_t shards = std::thread::hardware_concurrency();
+	if (shards < 1)
+		shards = 1;
+	if (shards > idle_count)
+		shards = idle_count;
+
+	List list(shards, idle_count);
+	std::vector<fake_connection> connections(idle_count);
+	for (auto & conn : connections)
+		list.try_push(&conn);
+
+	zdb2::histogram latency;
+	std::atomic<bool> start{ false }, stop{ false };
+	std::atomic<std::uint64_t> total{ 0 };
+
+	std::vector<std::thread> workers;
+	for (std::size_t i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&]()
+		{
+			while (!start.load())
+				std::this_thread::yield();
+
+			std::uint64_t count = 0;
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				auto t0 = std::chrono::steady_clock::now();
+
+				fake_connection * conn = nullptr;
+				while (!list.try_pop(conn))
+					std::this_thread::yield();
+
+				conn->buffer[count % sizeof(conn->buffer)]++;
+
+				list.try_push(conn);
+
+				latency.record((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - t0).count());
+				count++;
+			}
+			total += count;
+		});
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	start = true;
+	std::this_thread::sleep_for(std::chrono::milliseconds((long long)(seconds * 1000)));
+	stop = true;
+	for (auto & t : workers)
+		t.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	zdb2::histogram_snapshot s = latency.snapshot();
+	std::printf("%-8s %3u threads %12.0f ops/s   p50 %8llu ns   p99 %8llu ns\n", name, (unsigned)threads,
+		(double)total.load() / elapsed, (unsigned long long)s.percentile(50), (unsigned long long)s.percentile(99));
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = (argc > 1 ? std::atof(argv[1]) : 1.0);
+	std::size_t idle_count = (argc > 2 ? (std::size_t)std::atoi(argv[2]) : 64);
+	if (seconds <= 0)
+		seconds = 1.0;
+	if (idle_count < 1)
+		idle_count = 1;
+
+	std::printf("%u hardware threads,%u idle connections,%.1f seconds per run\n",
+		std::thread::hardware_concurrency(), (unsigned)idle_count, seconds);
+
+	for (std::size_t threads = 1; threads <= 64; threads *= 2)
+	{
+		run<deque_list>("deque", threads, idle_count, seconds);
+		run<mpmc_list>("mpmc", threads, idle_count, seconds);
+		run<sharded_list>("sharded", threads, idle_count, seconds);
+	}
+
+	return 0;
+};
@@ -50,9 +50,9 @@ int main(int argc, char *argv[])
 
 	std::shared_ptr<zdb2::connection> conn = pool_ptr->get();
 
-	conn->execute("update tbl_anchor set x=%f", 12.34);
+	conn->exec("update tbl_anchor set x=?", 12.34);
 
-	auto result = conn->query("select * from tbl_anchor");
+	auto result = conn->select("select * from tbl_anchor where x>?", 0);
 	if (result->next_row())
 	{
 		std::printf("id = %lld name=%s\n", result->get_int64("id"), result->get_string("name"));
@@ -0,0 +1,83 @@
+// the regression test of connection::select with temporary arguments,compile it on linux system with :
+// g++ -std=c++11 -g -fsanitize=address -lpthread -ldl regress_select.cpp -o regress_select.exe -I .. -l sqlite3
+// usage : regress_select.exe
+//
+// select binds the arguments and returns the resultset,SQLite runs the query at the first next_row,
+// after the temporary arguments of the select call are destroyed,so the strings and blobs must be
+// copied when they are bound.Under AddressSanitizer a use after free is reported if they are not.
+// the exit code is 0 if all the checks pass.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <zdb2/zdb.hpp>
+
+static std::string key(int i)
+{
+	// long enough to be allocated on the heap,not in the small string buffer
+	return "the name of the row number " + std::to_string(i);
+}
+
+static std::vector<char> payload(int i)
+{
+	return std::vector<char>(64, (char)i);
+}
+
+int main()
+{
+	std::remove("regress_select.db3");
+
+	std::shared_ptr<zdb2::url> url_ptr = std::make_shared<zdb2::url>("sqlite://regress_select.db3?synchronous=off");
+	std::shared_ptr<zdb2::pool> pool_ptr = std::make_shared<zdb2::pool>(url_ptr, 1, 30, 3000, 1);
+	std::shared_ptr<zdb2::connection> conn = pool_ptr->get();
+
+	conn->execute("create table t(id integer, name text, data blob)");
+	for (int i = 0; i < 10; i++)
+	{
+		std::vector<char> data = payload(i);
+		conn->exec("insert into t values(?,?,?)", i, key(i), zdb2::blob(data.data(), data.size()));
+	}
+
+	int failed = 0;
+
+	for (int i = 0; i < 10; i++)
+	{
+		// the std::string returned by key(i) is destroyed before next_row
+		auto rs = conn->select("select id from t where name=?", key(i));
+		if (!rs->next_row() || rs->get_int(0) != i)
+		{
+			std::printf("select by a temporary string failed,row %d\n", i);
+			failed++;
+		}
+	}
+
+	for (int i = 0; i < 10; i++)
+	{
+		std::shared_ptr<zdb2::resultset> rs;
+		{
+			std::vector<char> data = payload(i);
+			rs = conn->select("select id from t where data=?", zdb2::blob(data.data(), data.size()));
+		}
+		if (!rs->next_row() || rs->get_int(0) != i)
+		{
+			std::printf("select by a temporary blob failed,row %d\n", i);
+			failed++;
+		}
+	}
+
+	// the cached statement is bound without copies again by exec
+	if (conn->exec("update t set id=id+100 where name=?", key(3)) != 1)
+	{
+		std::printf("exec after select failed\n");
+		failed++;
+	}
+
+	conn.reset();
+	pool_ptr.reset();
+	std::remove("regress_select.db3");
+
+	std::printf("%s\n", failed ? "FAILED" : "OK");
+	return (failed ? 1 : 0);
+};
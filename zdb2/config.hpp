@@ -13,6 +13,47 @@
 #include <cstdint>
 #include <cstddef>
 
+/* --------------------------------------------- Language features */
+
+#if defined(_MSVC_LANG)
+#define ZDB2_CPLUSPLUS _MSVC_LANG
+#else
+#define ZDB2_CPLUSPLUS __cplusplus
+#endif
+
+/**
+ * C++ 20 coroutine support,used by the pool awaitable
+ */
+#if ZDB2_CPLUSPLUS >= 202002L && defined(__cpp_impl_coroutine)
+#define ZDB2_HAS_COROUTINE
+#endif
+
+/**
+ * C++ 17 std::string_view and C++ 20 std::span support,used by the resultset accessors
+ */
+#if defined(__has_include)
+#if ZDB2_CPLUSPLUS >= 201703L && __has_include(<string_view>)
+#define ZDB2_HAS_STRING_VIEW
+#endif
+#if ZDB2_CPLUSPLUS >= 202002L && __has_include(<span>)
+#define ZDB2_HAS_SPAN
+#endif
+#endif
+
+/**
+ * SSE2 instructions,used by the fast path of the date and time parser
+ */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZDB2_HAS_SSE2
+#endif
+
+/**
+ * the tm_gmtoff member of struct tm,on the other systems the gmt offset is set to tm_wday
+ */
+#if defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define ZDB2_HAS_TM_GMTOFF
+#endif
+
 namespace zdb2
 {
 
@@ -44,6 +85,120 @@ const static std::size_t DEFAULT_MAX_CONNECTIONS = 20;
 const static std::size_t DEFAULT_INIT_CONNECTIONS = 5;
 
 
+/**
+ * The default number of connector threads used to open the initial database
+ * connections concurrently in parallel or lazy warmup mode
+ */
+const static std::size_t DEFAULT_WARMUP_THREADS = 4;
+
+
+/**
+ * The default number of idle connection shards of a ConnectionPool, zero means
+ * one shard per hardware thread
+ */
+const static std::size_t DEFAULT_SHARD_COUNT = 0;
+
+
+/**
+ * The default minimum number of idle database connections kept open by the
+ * elastic sizing policy when the load falls
+ */
+const static std::size_t DEFAULT_MIN_IDLE_CONNECTIONS = 2;
+
+
+/**
+ * The default sample interval in milliseconds of the elastic sizing policy
+ */
+const static std::size_t DEFAULT_ELASTIC_INTERVAL = 1000;
+
+
+/**
+ * The default weight of the newest sample in the moving averages used by the
+ * elastic sizing policy
+ */
+const static double DEFAULT_ELASTIC_ALPHA = 0.3;
+
+
+/**
+ * The default number of prepared statements cached by a Connection, zero
+ * disables the statement cache
+ */
+const static std::size_t DEFAULT_STMT_CACHE_SIZE = 32;
+
+
+/**
+ * The maximum number of rows sent in one multi-row INSERT statement by
+ * Connection insert_many on the backends which support it
+ */
+const static std::size_t DEFAULT_BATCH_ROWS = 1000;
+
+
+/**
+ * The size in bytes of the inline buffer used to format the SQL text of a
+ * Connection call, longer statements are formatted on the heap
+ */
+const static std::size_t DEFAULT_FORMAT_BUFFER_SIZE = 1024;
+
+
+/**
+ * The default memory budget in bytes of the ConnectionPool query result
+ * cache, the least recently used results are evicted beyond it
+ */
+const static std::size_t DEFAULT_QUERY_CACHE_SIZE = 64 * 1024 * 1024;
+
+
+/**
+ * The default number of milliseconds a cached query result is valid
+ */
+const static std::size_t DEFAULT_QUERY_CACHE_TTL = 60 * 1000;
+
+
+/**
+ * The first and the longest sleep in microseconds between the retries of
+ * a SQLite call which is blocked by a lock, the sleep doubles after every
+ * retry until the query timeout is reached
+ */
+const static std::size_t DEFAULT_BUSY_BACKOFF_MIN = 100;
+const static std::size_t DEFAULT_BUSY_BACKOFF_MAX = 50 * 1000;
+
+
+/**
+ * The number of SQLite virtual machine instructions between the checks of
+ * the query timeout of a running statement
+ */
+const static int DEFAULT_PROGRESS_INTERVAL = 1000;
+
+
+/**
+ * The default millisecond threshold of the slow queries of the statement
+ * tracer, the executions longer than it are passed to the slow query sink
+ */
+const static std::size_t DEFAULT_SLOW_QUERY_THRESHOLD = 1000;
+
+
+/**
+ * The maximum number of normalized statements which have their own
+ * statistics in the statement tracer, the others share one entry
+ */
+const static std::size_t DEFAULT_TRACE_STATEMENTS = 256;
+
+
+/**
+ * The default capacity of the write queue of a SQLite WAL pool, the callers
+ * wait while it is full
+ */
+const static std::size_t DEFAULT_WRITE_QUEUE_SIZE = 4096;
+
+
+/**
+ * The default millisecond window in which the group commit writer of a
+ * ConnectionPool gathers the writes into one transaction, and the maximum
+ * number of writes in one transaction
+ */
+const static std::size_t DEFAULT_GROUP_COMMIT_WINDOW = 2;
+const static std::size_t DEFAULT_GROUP_COMMIT_SIZE = 256;
+
+
 /**
  * The standard sweep interval in seconds for a ConnectionPool reaper thread
  */
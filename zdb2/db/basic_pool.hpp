@@ -0,0 +1,1634 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ * 
+ */
+
+
+#pragma once
+
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <future>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+
+#include <zdb2/config.hpp>
+
+#if defined(ZDB2_HAS_COROUTINE)
+#include <coroutine>
+#endif
+
+#include <zdb2/net/url.hpp>
+#include <zdb2/util/spin_lock.hpp>
+#include <zdb2/util/sharded_queue.hpp>
+#include <zdb2/util/ewma.hpp>
+#include <zdb2/util/striped_counter.hpp>
+#include <zdb2/util/histogram.hpp>
+
+#include <zdb2/db/connection.hpp>
+#include <zdb2/db/rowset.hpp>
+#include <zdb2/db/query_cache.hpp>
+#include <zdb2/db/tracer.hpp>
+#include <zdb2/db/group_commit.hpp>
+
+namespace zdb2 
+{
+
+	/**
+	 * the connection type of the backend,eg : basic_connection<sqlite_backend> is sqlite_connection.
+	 */
+	template<class Backend>
+	using basic_connection = typename Backend::connection_type;
+
+	/**
+	 * the resultset type of the backend,eg : basic_resultset<sqlite_backend> is sqlite_resultset.
+	 */
+	template<class Backend>
+	using basic_resultset = typename Backend::resultset_type;
+
+	/**
+	 * the connection pool of the backend which is fixed at compile time.the Backend provides the connection_type,
+	 * resultset_type,stmt_type,and the functions to create connection,eg : 
+	 * auto pool_ptr = std::make_shared<zdb2::basic_pool<zdb2::sqlite_backend>>(url_ptr);
+	 * std::shared_ptr<zdb2::sqlite_connection> conn = pool_ptr->get();
+	 * the backend classes are final,so the calls on them are resolved at compile time and can be inlined,
+	 * see the zdb2::pool for the backend chosen by the url at runtime.
+	 */
+	template<class Backend>
+	class basic_pool : public std::enable_shared_from_this<basic_pool<Backend>>
+	{
+	public:
+		typedef Backend backend_type;
+		typedef typename Backend::connection_type connection_type;
+		typedef typename Backend::resultset_type  resultset_type;
+		typedef typename Backend::stmt_type       stmt_type;
+
+	protected:
+		/// a caller parked in get_for/get_until,or a pending async_get request
+		struct waiter
+		{
+			std::condition_variable cv;
+			connection_type * conn = nullptr;
+
+			/// not empty for the async_get request
+			std::function<void(std::shared_ptr<connection_type>)> callback;
+			std::chrono::steady_clock::time_point start_time;
+		};
+
+	public:
+		/**
+		 * how to open the initial connections,it can also be set by the url parameter 
+		 * "warmup=serial|parallel|lazy",the url parameter takes precedence.
+		 */
+		enum class warmup_mode
+		{
+			/// open the initial connections one after another in the constructor
+			serial,
+
+			/// open the initial connections concurrently by "warmup-threads" connector threads in the constructor
+			parallel,
+
+			/// the constructor returns immediately,a background thread fills the pool up to init_conn_count
+			lazy,
+		};
+
+		/**
+		 * the moving averages measured by the elastic sizing policy,see set_elastic.
+		 */
+		struct elastic_stats
+		{
+			/// average of using count / max connections count,in range [0,1]
+			double utilization = 0;
+
+			/// average count of the connections in demand (using and waiting)
+			double demand = 0;
+
+			/// average length of the waiting queue
+			double waiting = 0;
+
+			/// average acquisition latency in microseconds
+			double latency_us = 0;
+
+			/// the connections count the policy is heading to
+			std::size_t target = 0;
+		};
+
+		/**
+		 * the statistics of the reaper,see get_sweep_stats.
+		 */
+		struct sweep_stats
+		{
+			/// count of the sweeps done
+			std::size_t sweep_count = 0;
+
+			/// total count of the idle connections checked and closed by all sweeps
+			std::size_t checked_count = 0;
+			std::size_t closed_count = 0;
+
+			/// count of the idle connections checked and closed by the last sweep
+			std::size_t last_checked_count = 0;
+			std::size_t last_closed_count = 0;
+
+			/// elapsed time of the last sweep,include ping and close connections
+			std::chrono::steady_clock::duration last_sweep_time{ 0 };
+
+			/// time the last sweep holding the pool lock to take out the idle connections
+			std::chrono::steady_clock::duration last_lock_hold_time{ 0 };
+
+			std::chrono::steady_clock::duration max_sweep_time{ 0 };
+			std::chrono::steady_clock::duration max_lock_hold_time{ 0 };
+		};
+
+		/**
+		 * a snapshot of the pool metrics,see get_stats.
+		 */
+		struct stats
+		{
+			std::size_t idle_count = 0;
+			std::size_t using_count = 0;
+			std::size_t waiting_count = 0;
+
+			/// total count of connections (idle and using)
+			std::size_t conn_count = 0;
+
+			/// count of the successful and failed (no connection or timeout) acquisitions
+			std::uint64_t acquire_count = 0;
+			std::uint64_t acquire_failed_count = 0;
+
+			/// count of the connections opened,and the failed attempts to open a connection
+			std::uint64_t created_count = 0;
+			std::uint64_t connect_failed_count = 0;
+
+			/// count of the connections closed by reason
+			std::uint64_t closed_timeout_count = 0;  ///< idle longer than the connection timeout
+			std::uint64_t closed_ping_count = 0;     ///< ping failed in the reaper
+			std::uint64_t closed_error_count = 0;    ///< can't be returned to the idle queue
+			std::uint64_t closed_shrink_count = 0;   ///< closed by the elastic sizing policy
+
+			/// histogram of the acquisition waiting time in microseconds
+			histogram_snapshot wait_time;
+
+			/// histogram of the time a connection is held by the borrower in microseconds
+			histogram_snapshot hold_time;
+		};
+
+		/// the hook called with the connection and the waiting time of the acquisition
+		typedef std::function<void(connection_type &, std::chrono::steady_clock::duration)> acquire_hook;
+
+		/// the hook called with the connection and the time it is held by the borrower
+		typedef std::function<void(connection_type &, std::chrono::steady_clock::duration)> release_hook;
+
+		basic_pool(
+			std::shared_ptr<url> url_ptr,
+			std::size_t init_conn_count = zdb2::DEFAULT_INIT_CONNECTIONS,
+			std::size_t conn_timeout    = zdb2::DEFAULT_CONNECTION_TIMEOUT,
+			std::size_t execute_timeout = zdb2::DEFAULT_TIMEOUT,
+			std::size_t max_conn_count  = zdb2::DEFAULT_MAX_CONNECTIONS,
+			std::size_t sweep_interval  = zdb2::DEFAULT_SWEEP_INTERVAL,
+			warmup_mode warmup          = warmup_mode::serial
+		)
+			: m_url_ptr(url_ptr)
+			, m_connections(_shard_count(url_ptr, max_conn_count), max_conn_count)
+			, m_init_conn_count(init_conn_count)
+			, m_conn_timeout(conn_timeout)
+			, m_execute_timeout(execute_timeout)
+			, m_max_conn_count(max_conn_count)
+			, m_sweep_interval(sweep_interval)
+			, m_warmup(warmup)
+		{
+			_init();
+		}
+
+		virtual ~basic_pool()
+		{
+			destroy();
+			// check whether all connection is not using.
+			assert(m_using_count == 0);
+		}
+
+		std::shared_ptr<url> get_url()
+		{
+			return m_url_ptr;
+		}
+
+		/**
+		 * Get a connection from the pool,return nullptr immediately if there is no idle connection
+		 * and the connections count has reached the max connections count.
+		 */
+		std::shared_ptr<connection_type> get()
+		{
+			auto start_time = std::chrono::steady_clock::now();
+
+			// the idle connections are sharded per thread,so acquire a idle connection never take the pool lock
+			connection_type * conn = _try_acquire();
+
+			return _wrap(conn, start_time);
+		}
+
+		/**
+		 * Get a connection from the pool,if there is no idle connection and the connections count has
+		 * reached the max connections count,the caller will be parked in a FIFO waiting queue until a 
+		 * connection is returned to the pool or the timeout is elapsed.
+		 * @param timeout The max waiting time
+		 * @return nullptr if no connection is available before timeout
+		 */
+		std::shared_ptr<connection_type> get_for(std::chrono::milliseconds timeout)
+		{
+			return get_until(std::chrono::steady_clock::now() + timeout);
+		}
+
+		/**
+		 * Get a connection from the pool,if there is no idle connection and the connections count has
+		 * reached the max connections count,the caller will be parked in a FIFO waiting queue until a 
+		 * connection is returned to the pool or the deadline is reached.
+		 * @param deadline The time point to stop waiting
+		 * @return nullptr if no connection is available before deadline
+		 */
+		std::shared_ptr<connection_type> get_until(std::chrono::steady_clock::time_point deadline)
+		{
+			auto start_time = std::chrono::steady_clock::now();
+
+			connection_type * conn = _try_acquire();
+			if (!conn)
+				conn = _wait_until(deadline);
+
+			return _wrap(conn, start_time);
+		}
+
+		/**
+		 * Get a connection from the pool asynchronously,the callback will be called with the connection
+		 * immediately in the caller thread if a connection is available,otherwise the request is appended
+		 * to the FIFO waiting queue,and the callback will be called in the thread which returns a connection
+		 * to the pool,so the callback should not block.The callback will be called with nullptr if the pool
+		 * is destroyed before a connection is available.
+		 * @param callback The handler with signature void(std::shared_ptr<connection_type>)
+		 */
+		void async_get(std::function<void(std::shared_ptr<connection_type>)> callback)
+		{
+			auto start_time = std::chrono::steady_clock::now();
+
+			connection_type * conn = _try_acquire();
+			if (conn)
+			{
+				callback(_wrap(conn, start_time));
+				return;
+			}
+
+			waiter * w = new waiter();
+			w->callback = std::move(callback);
+			w->start_time = start_time;
+
+			{
+				std::lock_guard<std::mutex> g(m_wait_mtx);
+
+				m_waiters.emplace_back(w);
+				m_waiting_count++;
+
+				// must be ordered before the releaser check the m_waiting_count,see _dispatch
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				// a connection may be returned to the idle queue before we are in the waiting queue
+				if (!m_connections.try_pop(conn))
+					return;
+
+				w = _handoff(conn);
+			}
+
+			_complete(w);
+		}
+
+		/**
+		 * Get a connection from the pool asynchronously,the future will be ready when a connection is 
+		 * available,see async_get(callback).
+		 */
+		std::future<std::shared_ptr<connection_type>> async_get()
+		{
+			std::shared_ptr<std::promise<std::shared_ptr<connection_type>>> promise_ptr =
+				std::make_shared<std::promise<std::shared_ptr<connection_type>>>();
+
+			std::future<std::shared_ptr<connection_type>> future = promise_ptr->get_future();
+
+			async_get([promise_ptr](std::shared_ptr<connection_type> conn)
+			{
+				promise_ptr->set_value(std::move(conn));
+			});
+
+			return future;
+		}
+
+#if defined(ZDB2_HAS_COROUTINE)
+		/**
+		 * c++ 20 coroutine awaitable,eg : auto conn = co_await pool_ptr->co_get();
+		 * the coroutine will be resumed in the thread which returns a connection to the pool.
+		 */
+		class get_awaitable
+		{
+		public:
+			explicit get_awaitable(basic_pool * p) : m_pool(p)
+			{
+			}
+
+			bool await_ready()
+			{
+				m_conn = m_pool->get();
+				return (m_conn != nullptr);
+			}
+
+			bool await_suspend(std::coroutine_handle<> handle)
+			{
+				m_pool->async_get([this, handle](std::shared_ptr<connection_type> conn)
+				{
+					m_conn = std::move(conn);
+					// if the callback is called before await_suspend return,don't resume here
+					if (m_done.exchange(true))
+						handle.resume();
+				});
+				return !m_done.exchange(true);
+			}
+
+			std::shared_ptr<connection_type> await_resume()
+			{
+				return std::move(m_conn);
+			}
+
+		protected:
+			basic_pool * m_pool = nullptr;
+			std::shared_ptr<connection_type> m_conn;
+			std::atomic<bool> m_done{ false };
+		};
+
+		get_awaitable co_get()
+		{
+			return get_awaitable(this);
+		}
+#endif
+
+		/**
+		 * Returns the count of callers which are waiting for a connection in get_for/get_until/async_get.
+		 */
+		std::size_t get_waiting_count()
+		{
+			return m_waiting_count.load();
+		}
+
+		/**
+		 * Returns the count of connections which are being used now.
+		 */
+		std::size_t get_using_count()
+		{
+			return m_using_count.load();
+		}
+
+		/**
+		 * Returns the count of idle connections.
+		 */
+		std::size_t get_idle_count()
+		{
+			return m_connections.size();
+		}
+
+		/**
+		 * Returns the count of the idle connections shards,it can be set by the url parameter "shards=4",
+		 * the default is one shard per hardware thread.
+		 */
+		std::size_t get_shard_count()
+		{
+			return m_connections.shard_count();
+		}
+
+		/**
+		 * Enable or disable the elastic sizing policy,it can also be set by the url parameters 
+		 * "elastic=true&min-idle=2&elastic-interval=1000",the url parameters take precedence.
+		 * When enabled,the sweep thread samples the utilization,waiting queue length and acquisition
+		 * latency every elastic interval and smooths them with moving averages,then opens connections
+		 * ahead of a rising load,and closes the idle connections gradually down to min_idle when the 
+		 * load falls.The reaper will also keep min_idle idle connections open even if they timed out.
+		 * @param min_idle The minimum count of idle connections kept open
+		 */
+		void set_elastic(bool enable, std::size_t min_idle = zdb2::DEFAULT_MIN_IDLE_CONNECTIONS)
+		{
+			m_min_idle = (std::min)(min_idle, m_max_conn_count);
+			m_elastic = enable;
+
+			// wake up the sweep thread to use the new interval
+			std::unique_lock<std::mutex> lck(m_mtx);
+			m_cv.notify_all();
+		}
+
+		bool is_elastic()
+		{
+			return m_elastic;
+		}
+
+		/**
+		 * Returns the moving averages measured by the elastic sizing policy.
+		 */
+		elastic_stats get_elastic_stats()
+		{
+			std::lock_guard<std::mutex> g(m_elastic_mtx);
+			return m_elastic_stats;
+		}
+
+		/**
+		 * Returns the statistics of the reaper,include the elapsed time of the sweeps and how long the 
+		 * sweeps hold the pool lock.
+		 */
+		sweep_stats get_sweep_stats()
+		{
+			std::lock_guard<std::mutex> g(m_sweep_mtx);
+			return m_sweep_stats;
+		}
+
+		/**
+		 * Returns a snapshot of the pool metrics.The counters are striped per thread,so recording them 
+		 * is cheap,but taking a snapshot has to sum all the stripes,don't call it too frequently.
+		 */
+		stats get_stats()
+		{
+			stats s;
+
+			s.idle_count           = m_connections.size();
+			s.using_count          = m_using_count.load();
+			s.waiting_count        = m_waiting_count.load();
+			s.conn_count           = m_conn_count.load();
+			s.acquire_count        = m_acquire_counter.load();
+			s.acquire_failed_count = m_acquire_failed_counter.load();
+			s.created_count        = m_created_counter.load();
+			s.connect_failed_count = m_connect_failed_counter.load();
+			s.closed_timeout_count = m_closed_timeout_counter.load();
+			s.closed_ping_count    = m_closed_ping_counter.load();
+			s.closed_error_count   = m_closed_error_counter.load();
+			s.closed_shrink_count  = m_closed_shrink_counter.load();
+			s.wait_time            = m_wait_histogram.snapshot();
+			s.hold_time            = m_hold_histogram.snapshot();
+
+			return s;
+		}
+
+		/**
+		 * Returns the first error of opening the initial connections,nullptr if all of them are opened,or
+		 * the lazy warm-up is still running.The failed attempts are also counted in connect_failed_count
+		 * of get_stats.
+		 * eg : if (auto e = pool_ptr->get_warmup_error()) std::rethrow_exception(e);
+		 */
+		std::exception_ptr get_warmup_error()
+		{
+			std::lock_guard<std::mutex> g(m_warmup_mtx);
+			return m_warmup_error;
+		}
+
+		/**
+		 * Set the hook called after a connection is got from the pool,in the thread which gets the 
+		 * connection,the hook should not block.Set it before the pool is used,it is not thread safe.
+		 */
+		void on_acquire(acquire_hook hook)
+		{
+			m_on_acquire = std::move(hook);
+		}
+
+		/**
+		 * Set the hook called before a connection is returned to the pool,in the thread which releases
+		 * the connection,the hook should not block.Set it before the pool is used,it is not thread safe.
+		 */
+		void on_release(release_hook hook)
+		{
+			m_on_release = std::move(hook);
+		}
+
+		/**
+		 * Enable the query result cache used by cached_select,it can also be set by the url parameters
+		 * "query-cache=67108864&query-cache-ttl=60000".The results are dropped when they are older than
+		 * the ttl,or the least recently used ones when the memory exceeds max_bytes,or when a table they
+		 * read is written through a connection of this pool (by execute,exec,insert_many or a prepared
+		 * statement).The tables written by other clients are not seen,call invalidate for them,or keep 
+		 * the ttl short.Set it before the pool is used,it is not thread safe.
+		 * @param max_bytes The memory budget of the cached results,zero disables the cache
+		 * @param ttl How long a result is valid
+		 */
+		void enable_query_cache(
+			std::size_t max_bytes = zdb2::DEFAULT_QUERY_CACHE_SIZE,
+			std::chrono::milliseconds ttl = std::chrono::milliseconds(zdb2::DEFAULT_QUERY_CACHE_TTL))
+		{
+			if (max_bytes == 0)
+				m_query_cache.reset();
+			else if (m_query_cache)
+			{
+				m_query_cache->set_capacity(max_bytes);
+				m_query_cache->set_ttl(ttl);
+			}
+			else
+				m_query_cache = std::make_shared<query_cache>(max_bytes, ttl);
+		}
+
+		std::shared_ptr<query_cache> get_query_cache()
+		{
+			return m_query_cache;
+		}
+
+		/**
+		 * Returns the hits,misses,evictions and memory of the query result cache.
+		 */
+		query_cache_stats get_query_cache_stats()
+		{
+			return (m_query_cache ? m_query_cache->get_stats() : query_cache_stats());
+		}
+
+		/**
+		 * Drop the cached results which read the table,eg : after the table is written by another client.
+		 * @param table The table name without the schema,case insensitive
+		 */
+		void invalidate(const std::string & table)
+		{
+			if (m_query_cache)
+				m_query_cache->invalidate(table);
+		}
+
+		/**
+		 * Enable the statement tracer,it can also be set by the url parameters "trace=true&slow-query=1000".
+		 * The prepare,execute and fetch times,the rows,the bytes and the errors of every execution through a
+		 * connection of this pool are aggregated per statement fingerprint (see get_statement_stats),and the
+		 * executions longer than the threshold are passed to the sink with the values of the parameters.When it is
+		 * disabled,a execution only checks a null pointer.Set it before the pool is used,it is not thread
+		 * safe.
+		 * eg : pool_ptr->enable_tracing(std::chrono::milliseconds(200), [](const zdb2::slow_query & q) { ... });
+		 * @param slow_threshold The slow query threshold,zero disables the slow query check
+		 * @param sink Receives the slow queries in the thread which ran the statement,it may be empty
+		 */
+		void enable_tracing(
+			std::chrono::microseconds slow_threshold = std::chrono::milliseconds(zdb2::DEFAULT_SLOW_QUERY_THRESHOLD),
+			tracer::slow_query_sink sink = nullptr)
+		{
+			if (!m_tracer)
+				m_tracer = std::make_shared<tracer>();
+			m_tracer->set_slow_threshold(slow_threshold);
+			m_tracer->set_slow_query_sink(std::move(sink));
+		}
+
+		/**
+		 * Disable the statement tracer,the connections in use stop tracing when they are got from the pool again.
+		 * It is not thread safe.
+		 */
+		void disable_tracing()
+		{
+			m_tracer.reset();
+		}
+
+		std::shared_ptr<tracer> get_tracer()
+		{
+			return m_tracer;
+		}
+
+		/**
+		 * Returns the latency statistics of every statement fingerprint,empty if the tracing is disabled.
+		 */
+		std::vector<statement_stats_snapshot> get_statement_stats()
+		{
+			return (m_tracer ? m_tracer->get_stats() : std::vector<statement_stats_snapshot>());
+		}
+
+		/**
+		 * Returns the statistics of the n statements which took the most total time,they are the first
+		 * ones to batch,cache or index.see tracer::dump for a text table of them.
+		 */
+		std::vector<statement_stats_snapshot> get_top_statements(std::size_t n)
+		{
+			return (m_tracer ? m_tracer->top(n) : std::vector<statement_stats_snapshot>());
+		}
+
+		/**
+		 * Executes the query with the parameters (see connection::select) and returns all the rows,from 
+		 * the query result cache if the same sql with the same parameters is cached,see enable_query_cache.
+		 * The rows are not bound to a connection,and are shared by all the callers of the same query,so 
+		 * don't keep them longer than they are valid.
+		 * eg : auto rows = pool_ptr->cached_select("select * from t where id=?", id);
+		 * @param sql A single SELECT statement with '?' IN parameter placeholders
+		 * @return The rows of the query
+		 * @exception SQLException If no connection is available in the query timeout,or a database 
+		 * error occurs
+		 */
+		template<typename... Args>
+		std::shared_ptr<rowset> cached_select(const char * sql, const Args&... args)
+		{
+			std::shared_ptr<query_cache> cache = m_query_cache;
+			std::string key;
+			std::uint64_t ticket = 0;
+
+			if (cache)
+			{
+				key = query_cache::make_key(sql, args...);
+
+				std::shared_ptr<rowset> rows = cache->get(key);
+				if (rows)
+					return rows;
+
+				// the writes after here make the result stale,see query_cache::get_ticket
+				ticket = cache->get_ticket();
+			}
+
+			std::shared_ptr<rowset> rows;
+			{
+				std::shared_ptr<connection_type> conn = get_for(std::chrono::milliseconds(m_execute_timeout));
+				if (!conn)
+					throw std::runtime_error("no connection is available.");
+
+				rows = conn->select(sql, args...)->materialize();
+			}
+
+			if (cache)
+			{
+				std::vector<std::string> tables;
+				query_cache::parse_tables(sql, tables);
+				cache->put(key, tables, rows, ticket);
+			}
+
+			return rows;
+		}
+
+		/**
+		 * Enable the group commit writer used by group_exec,it can also be set by the url parameters
+		 * "group-commit=2&group-commit-size=256".The writes of all the threads are gathered over the window
+		 * or up to max_batch,and run in one transaction on one connection of this pool,see group_commit.
+		 * Set it before the pool is used,it is not thread safe.
+		 * @param window How long a batch waits for more writes after its first one
+		 * @param max_batch The maximum number of writes in one transaction
+		 */
+		void enable_group_commit(
+			std::chrono::milliseconds window = std::chrono::milliseconds(zdb2::DEFAULT_GROUP_COMMIT_WINDOW),
+			std::size_t max_batch = zdb2::DEFAULT_GROUP_COMMIT_SIZE)
+		{
+			// the writer is stopped by destroy before the pool is gone,so its connections don't hold the
+			// pool,otherwise the last reference may be dropped in the writer thread,which can't join itself
+			m_group_commit = std::make_shared<group_commit>([this](std::chrono::milliseconds timeout)
+			{
+				auto start_time = std::chrono::steady_clock::now();
+
+				connection_type * conn = _try_acquire();
+				if (!conn)
+					conn = _wait_until(start_time + timeout);
+
+				return std::shared_ptr<connection>(_wrap(conn, start_time, false));
+			}, window, max_batch, m_execute_timeout);
+		}
+
+		/**
+		 * Disable the group commit writer,the queued writes are committed first.It is not thread safe.
+		 */
+		void disable_group_commit()
+		{
+			m_group_commit.reset();
+		}
+
+		/**
+		 * Returns the writes,batches and errors of the group commit writer.
+		 */
+		group_commit_stats get_group_commit_stats()
+		{
+			return (m_group_commit ? m_group_commit->get_stats() : group_commit_stats());
+		}
+
+		/**
+		 * Executes the statement with the parameters (see connection::exec) in the next batch of the group 
+		 * commit writer,many small writes share one transaction and one commit.If the group commit is
+		 * disabled,the statement is executed at once by a connection of this pool.
+		 * eg : auto f = pool_ptr->group_exec("insert into log values(?,?)", id, msg); ... f.get();
+		 * @param sql A single INSERT,UPDATE,DELETE or REPLACE statement with '?' IN parameter placeholders
+		 * @return The future of the number of rows changed by the statement,it holds the error of it
+		 * @exception SQLException If the group commit writer is stopped
+		 */
+		template<typename... Args>
+		std::future<int64_t> group_exec(const char * sql, const Args&... args)
+		{
+			std::shared_ptr<group_commit> writer = m_group_commit;
+			if (writer)
+				return writer->exec(sql, args...);
+
+			std::promise<int64_t> promise;
+			try
+			{
+				std::shared_ptr<connection_type> conn = get_for(std::chrono::milliseconds(m_execute_timeout));
+				if (!conn)
+					throw std::runtime_error("no connection is available.");
+
+				promise.set_value(conn->exec(sql, args...));
+			}
+			catch (...)
+			{
+				promise.set_exception(std::current_exception());
+			}
+			return promise.get_future();
+		}
+
+		void destroy()
+		{
+			// commit the queued writes while the connections are still there
+			if (m_group_commit)
+				m_group_commit->stop();
+
+			if (m_sweep_thread_ptr && m_sweep_thread_ptr->joinable())
+			{
+				{
+					std::unique_lock<std::mutex> lck(m_mtx);
+					m_stopped = true;
+					m_cv.notify_all();
+				}
+
+				m_sweep_thread_ptr->join();
+			}
+			if (m_warmup_thread_ptr && m_warmup_thread_ptr->joinable())
+			{
+				m_stopped = true;
+
+				m_warmup_thread_ptr->join();
+			}
+			{
+				// complete the pending async_get requests with nullptr
+				std::deque<waiter *> waiters;
+				{
+					std::lock_guard<std::mutex> g(m_wait_mtx);
+					for (auto it = m_waiters.begin(); it != m_waiters.end();)
+					{
+						if ((*it)->callback)
+						{
+							waiters.emplace_back(*it);
+							it = m_waiters.erase(it);
+						}
+						else
+						{
+							(*it)->cv.notify_one();
+							it++;
+						}
+					}
+				}
+				for (auto w : waiters)
+				{
+					_complete(w);
+				}
+			}
+			{
+				std::lock_guard<spin_lock> g(m_lock);
+
+				connection_type * conn = nullptr;
+				while (m_connections.try_pop(conn))
+				{
+					delete conn;
+					m_conn_count--;
+				}
+			}
+		}
+
+	protected:
+		bool _init()
+		{
+			if (!Backend::is_supported(m_url_ptr->get_dbtype()))
+				throw std::runtime_error("unknown database type.");
+
+			std::string warmup = m_url_ptr->get_param_value("warmup");
+			if (warmup == "serial")
+				m_warmup = warmup_mode::serial;
+			else if (warmup == "parallel")
+				m_warmup = warmup_mode::parallel;
+			else if (warmup == "lazy")
+				m_warmup = warmup_mode::lazy;
+
+			std::string threads = m_url_ptr->get_param_value("warmup-threads");
+			if (!threads.empty() && std::atoi(threads.c_str()) > 0)
+				m_warmup_threads = (std::size_t)std::atoi(threads.c_str());
+
+			std::string elastic = m_url_ptr->get_param_value("elastic");
+			if (!elastic.empty())
+				m_elastic = (elastic == "true" || elastic == "1");
+
+			std::string min_idle = m_url_ptr->get_param_value("min-idle");
+			if (!min_idle.empty() && std::atoi(min_idle.c_str()) >= 0)
+				m_min_idle = (std::min)((std::size_t)std::atoi(min_idle.c_str()), m_max_conn_count);
+
+			std::string interval = m_url_ptr->get_param_value("elastic-interval");
+			if (!interval.empty() && std::atoi(interval.c_str()) > 0)
+				m_elastic_interval = (std::size_t)std::atoi(interval.c_str());
+
+			std::string cache_size = m_url_ptr->get_param_value("query-cache");
+			if (!cache_size.empty() && std::atoll(cache_size.c_str()) > 0)
+			{
+				std::string ttl = m_url_ptr->get_param_value("query-cache-ttl");
+				enable_query_cache((std::size_t)std::atoll(cache_size.c_str()), std::chrono::milliseconds(
+					(!ttl.empty() && std::atoll(ttl.c_str()) > 0) ? std::atoll(ttl.c_str()) : zdb2::DEFAULT_QUERY_CACHE_TTL));
+			}
+
+			std::string trace = m_url_ptr->get_param_value("trace");
+			if (trace == "true" || trace == "1")
+			{
+				std::string slow = m_url_ptr->get_param_value("slow-query");
+				enable_tracing(std::chrono::milliseconds(
+					(!slow.empty() && std::atoll(slow.c_str()) >= 0) ? std::atoll(slow.c_str()) : zdb2::DEFAULT_SLOW_QUERY_THRESHOLD));
+			}
+
+			std::string group = m_url_ptr->get_param_value("group-commit");
+			if (!group.empty() && group.find_first_not_of("0123456789") == std::string::npos)
+			{
+				std::string size = m_url_ptr->get_param_value("group-commit-size");
+				enable_group_commit(std::chrono::milliseconds(std::atoll(group.c_str())),
+					(!size.empty() && std::atoll(size.c_str()) > 0) ? (std::size_t)std::atoll(size.c_str()) : zdb2::DEFAULT_GROUP_COMMIT_SIZE);
+			}
+
+			if (m_warmup == warmup_mode::lazy)
+			{
+				m_warmup_thread_ptr = std::make_shared<std::thread>([this]()
+				{
+					_fill(m_warmup_threads);
+				});
+			}
+			else
+			{
+				// the connections are opened without m_lock,a connect may be a network round trip
+				std::exception_ptr error = _fill(m_warmup == warmup_mode::parallel ? m_warmup_threads : 1);
+
+				if (m_conn_count == 0)
+				{
+					if (error)
+						std::rethrow_exception(error);
+
+					throw std::runtime_error("failed to fill the pool with initial connections.");
+					return false;
+				}
+			}
+
+			m_sweep_thread_ptr = std::make_shared<std::thread>(std::bind(&basic_pool::_sweep_func, this));
+
+			return true;
+		}
+
+		/**
+		 * the idle connections are split into shards,a thread takes and returns the connections from its
+		 * own shard,so the connections it used recently are still hot in its core's cache.
+		 */
+		static std::size_t _shard_count(std::shared_ptr<url> url_ptr, std::size_t max_conn_count)
+		{
+			std::size_t count = zdb2::DEFAULT_SHARD_COUNT;
+
+			std::string shards = url_ptr->get_param_value("shards");
+			if (!shards.empty() && std::atoi(shards.c_str()) > 0)
+				count = (std::size_t)std::atoi(shards.c_str());
+
+			if (count == 0)
+				count = (std::size_t)std::thread::hardware_concurrency();
+
+			// more shards than connections only make the stealing slower
+			count = (std::min)(count, max_conn_count);
+
+			return (count > 0 ? count : 1);
+		}
+
+		/**
+		 * open connections until the connections count reach m_init_conn_count,by at most threads_count
+		 * connector threads,the caller thread is one of the connector threads.A connection is published
+		 * by _dispatch like a returned one,so no lock is held while the connections are opened.The error
+		 * is kept for get_warmup_error.
+		 * @return The first exception thrown when open connection
+		 */
+		std::exception_ptr _fill(std::size_t threads_count)
+		{
+			std::exception_ptr error;
+			std::mutex error_mtx;
+
+			auto connector = [this, &error, &error_mtx]()
+			{
+				while (!m_stopped)
+				{
+					try
+					{
+						// _create_connection may be called by get() at the same time,so check the count every time
+						if (m_conn_count >= m_init_conn_count)
+							break;
+
+						connection_type * conn = _create_connection();
+						if (!conn)
+							break;
+
+						_dispatch(conn);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> g(error_mtx);
+						if (!error)
+							error = std::current_exception();
+						break;
+					}
+				}
+			};
+
+			threads_count = (std::min)(threads_count, m_init_conn_count);
+
+			std::vector<std::thread> threads;
+			for (std::size_t i = 1; i < threads_count; i++)
+			{
+				threads.emplace_back(connector);
+			}
+
+			connector();
+
+			for (auto & thread : threads)
+			{
+				thread.join();
+			}
+
+			if (!error && !m_stopped && m_conn_count < m_init_conn_count)
+				error = std::make_exception_ptr(std::runtime_error("failed to fill the pool with initial connections."));
+
+			{
+				std::lock_guard<std::mutex> g(m_warmup_mtx);
+				m_warmup_error = error;
+			}
+
+			return error;
+		}
+
+		void _sweep_func()
+		{
+			auto last_sweep_time = std::chrono::steady_clock::now();
+
+			while (!m_stopped)
+			{
+				{
+					// the elastic sizing policy needs a faster tick than the reaper
+					std::unique_lock <std::mutex> lck(m_mtx);
+					if (m_elastic)
+						m_cv.wait_for(lck, (std::min)(std::chrono::milliseconds(m_elastic_interval),
+							std::chrono::milliseconds(std::chrono::seconds(m_sweep_interval))));
+					else
+						m_cv.wait_for(lck, std::chrono::seconds(m_sweep_interval));
+				}
+
+				if (m_stopped)
+					break;
+
+				if (m_elastic)
+					_adjust_size();
+
+				if (std::chrono::steady_clock::now() - last_sweep_time >= std::chrono::seconds(m_sweep_interval))
+				{
+					_reap_connections();
+
+					last_sweep_time = std::chrono::steady_clock::now();
+				}
+			}
+		}
+
+		/**
+		 * sample the load and move the connections count toward the forecast demand,called by the sweep 
+		 * thread every elastic interval.
+		 */
+		void _adjust_size()
+		{
+			std::size_t using_count   = m_using_count.load();
+			std::size_t waiting_count = m_waiting_count.load();
+
+			// the acquisitions and their waiting time since the last sample
+			std::uint64_t acquire_total = m_acquire_counter.load();
+			std::uint64_t wait_total    = m_wait_histogram.sum();
+			std::uint64_t acquire_count = acquire_total - m_last_acquire_count;
+			std::uint64_t acquire_wait  = wait_total - m_last_acquire_wait;
+			m_last_acquire_count = acquire_total;
+			m_last_acquire_wait  = wait_total;
+
+			double prev_demand = m_demand_ewma.value();
+
+			m_utilization_ewma.update(m_max_conn_count > 0 ? (double)using_count / (double)m_max_conn_count : 0);
+			m_demand_ewma.update((double)(using_count + waiting_count));
+			m_waiting_ewma.update((double)waiting_count);
+			m_latency_ewma.update(acquire_count > 0 ? (double)acquire_wait / (double)acquire_count : 0);
+
+			// extrapolate the demand one interval ahead while it is rising,so the connections are opened 
+			// before the callers have to wait for them,instead of a connect storm at the spike.
+			double trend = m_demand_ewma.value() - prev_demand;
+			double forecast = m_demand_ewma.value() + (trend > 0 ? trend : 0);
+
+			// callers are still queued,the pool is already behind the load
+			if (m_waiting_ewma.value() >= 0.5)
+				forecast += m_waiting_ewma.value();
+
+			std::size_t min_idle = m_min_idle;
+			// the moving average decays to 0 slowly,ignore the tiny remainder when round it up
+			std::size_t target = (std::size_t)std::ceil((std::max)(forecast - 0.1, 0.0)) + min_idle;
+			target = (std::min)(target, m_max_conn_count);
+
+			{
+				std::lock_guard<std::mutex> g(m_elastic_mtx);
+				m_elastic_stats.utilization = m_utilization_ewma.value();
+				m_elastic_stats.demand      = m_demand_ewma.value();
+				m_elastic_stats.waiting     = m_waiting_ewma.value();
+				m_elastic_stats.latency_us  = m_latency_ewma.value();
+				m_elastic_stats.target      = target;
+			}
+
+			std::size_t conn_count = m_conn_count.load();
+
+			if (conn_count < target)
+			{
+				for (std::size_t i = conn_count; i < target && !m_stopped; i++)
+				{
+					connection_type * conn = nullptr;
+					try
+					{
+						conn = _create_connection();
+					}
+					catch (...)
+					{
+					}
+
+					// the database may be unreachable now,try again at the next tick
+					if (!conn)
+						break;
+
+					_dispatch(conn);
+				}
+			}
+			else if (conn_count > target)
+			{
+				// close half of the surplus every tick,so a short dip of the load don't close the connections
+				// which will be opened again soon
+				std::size_t surplus = conn_count - target;
+				std::size_t close_count = (std::max)(surplus / 2, (std::size_t)1);
+
+				for (std::size_t i = 0; i < close_count && m_connections.size() > min_idle; i++)
+				{
+					// close the connections which are idle for the longest time,and keep the hot ones
+					connection_type * conn = nullptr;
+					if (!m_connections.try_pop_oldest(conn))
+						break;
+
+					delete conn;
+					m_conn_count--;
+					m_closed_shrink_counter.add();
+				}
+			}
+		}
+
+		void _reap_connections()
+		{
+			if (m_connections.empty())
+				return;
+
+			auto sweep_start_time = std::chrono::steady_clock::now();
+
+			std::vector<connection_type *> candidates;
+			std::chrono::steady_clock::duration lock_hold_time;
+
+			{
+				std::lock_guard<spin_lock> g(m_lock);
+
+				auto lock_time = std::chrono::steady_clock::now();
+
+				// only take out the connections which are idle now,the connections released during
+				// the sweep will be checked at the next sweep.
+				std::size_t count = m_connections.size();
+				candidates.reserve(count);
+
+				connection_type * conn = nullptr;
+				for (std::size_t i = 0; i < count && m_connections.try_pop(conn); i++)
+				{
+					candidates.emplace_back(conn);
+				}
+
+				lock_hold_time = std::chrono::steady_clock::now() - lock_time;
+			}
+
+			// ping and delete the connections without the lock,ping may be a network round trip,the 
+			// get() will create a new connection if the idle queue is empty during this time.
+			// the elastic sizing policy keeps min idle connections open even if they timed out
+			std::size_t keep_count = (m_elastic ? m_min_idle.load() : 0);
+			std::size_t remain = candidates.size();
+			std::size_t closed = 0;
+
+			for (auto conn : candidates)
+			{
+				auto time_diff = std::chrono::system_clock::now() - conn->get_last_access_time();
+				auto seconds = std::chrono::duration_cast<std::chrono::seconds>(time_diff).count();
+				bool expired = ((std::size_t)seconds > m_conn_timeout && remain > keep_count);
+				if (expired || !conn->ping())
+				{
+					if (expired)
+						m_closed_timeout_counter.add();
+					else
+						m_closed_ping_counter.add();
+
+					delete conn;
+					m_conn_count--;
+					remain--;
+					closed++;
+					_notify_waiter();
+				}
+				else
+				{
+					// a caller may be waiting for a connection now,so hand the survivor to it directly
+					_dispatch(conn);
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> g(m_sweep_mtx);
+				m_sweep_stats.sweep_count++;
+				m_sweep_stats.checked_count += candidates.size();
+				m_sweep_stats.closed_count += closed;
+				m_sweep_stats.last_checked_count = candidates.size();
+				m_sweep_stats.last_closed_count = closed;
+				m_sweep_stats.last_sweep_time = std::chrono::steady_clock::now() - sweep_start_time;
+				m_sweep_stats.last_lock_hold_time = lock_hold_time;
+				m_sweep_stats.max_sweep_time = (std::max)(m_sweep_stats.max_sweep_time, m_sweep_stats.last_sweep_time);
+				m_sweep_stats.max_lock_hold_time = (std::max)(m_sweep_stats.max_lock_hold_time, lock_hold_time);
+			}
+		}
+
+		/**
+		 * make the connection shared_ptr with the custom deleter which return the connection to the pool.
+		 * @param hold_pool Whether the deleter keeps the pool alive,false for the internal users which are
+		 * stopped by destroy
+		 */
+		std::shared_ptr<connection_type> _wrap(connection_type * conn, std::chrono::steady_clock::time_point start_time,
+			bool hold_pool = true)
+		{
+			if (!conn)
+			{
+				m_acquire_failed_counter.add();
+				return nullptr;
+			}
+
+			m_using_count++;
+
+			conn->m_acquire_time = std::chrono::steady_clock::now();
+			conn->m_acquire_wait_time = conn->m_acquire_time - start_time;
+
+			if (conn->m_query_cache != m_query_cache)
+				conn->m_query_cache = m_query_cache;
+			if (conn->m_tracer != m_tracer)
+				conn->m_tracer = m_tracer;
+
+			m_acquire_counter.add();
+			m_wait_histogram.record((std::uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				conn->m_acquire_wait_time).count());
+
+			if (m_on_acquire)
+				m_on_acquire(*conn, conn->m_acquire_wait_time);
+
+			// [important] : 
+			// if we make this_ptr by shared_from_this and passed it to the lumbda function,and the lumbda function
+			// is as the shared_ptr<connection> custom deleter,we must insure that the class connection is not derived
+			// from std::enable_shared_from_this,otherwise when application exit,the pool shared_ptr reference count
+			// will not desired to 0,so the pool destructor will not be called,and will cause memory leaks.Why does 
+			// this happen? i find that if we delete the connection pointer in the lumbda,this problem will not happen,
+			// but we can't delete the connection pointer in the lumbda under this design.
+			// [important] :
+			// why pass the this_ptr by shared_from_this to the lumdba function ? why not pass "this" pointer to the
+			// lumdba function directly?because the connection shared_ptr custom deleter has used "this" pool object,
+			// when the connection shared_ptr is destructed,it will call the custom deleter,but at this time the "this" 
+			// pool object may be destructed already before the connection shared_ptr destructed,this will cause crash,
+			// so pass a this_ptr by shared_from_this to the custom deleter,can make sure the "this" pool obejct is 
+			// destructed after the the connection shared_ptr destructed.
+			if (!hold_pool)
+			{
+				return std::shared_ptr<connection_type>(conn, [this](connection_type * conn)
+				{
+					this->_release(conn);
+				});
+			}
+
+			auto this_ptr = this->shared_from_this();
+			auto deleter = [this_ptr](connection_type * conn)
+			{
+				this_ptr->_release(conn);
+			};
+
+			return std::shared_ptr<connection_type>(conn, deleter);
+		}
+
+		/**
+		 * take a idle connection or create a new one,never block.
+		 */
+		connection_type * _try_acquire()
+		{
+			connection_type * conn = nullptr;
+			if (m_connections.try_pop(conn))
+				return conn;
+
+			return _create_connection();
+		}
+
+		/**
+		 * park the caller in the waiting queue until a connection is handed to it or deadline is reached.
+		 */
+		connection_type * _wait_until(std::chrono::steady_clock::time_point deadline)
+		{
+			waiter w;
+
+			std::unique_lock<std::mutex> lck(m_wait_mtx);
+
+			m_waiters.emplace_back(&w);
+			m_waiting_count++;
+
+			// must be ordered before the releaser check the m_waiting_count,see _dispatch
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			while (!w.conn)
+			{
+				// a connection may be returned to the idle queue before we are in the waiting queue
+				connection_type * conn = nullptr;
+				if (m_connections.try_pop(conn))
+				{
+					w.conn = conn;
+					break;
+				}
+
+				// some connections may be reaped,so we can create a new one,don't connect to the
+				// database while holding the lock
+				if (m_conn_count < m_max_conn_count)
+				{
+					lck.unlock();
+					try
+					{
+						conn = _create_connection();
+					}
+					catch (...)
+					{
+						lck.lock();
+						_remove_waiter(&w);
+						throw;
+					}
+
+					if (conn)
+					{
+						lck.lock();
+
+						// a connection was handed to us while we are creating,give this one to the next waiter
+						if (w.conn)
+						{
+							lck.unlock();
+							_dispatch(conn);
+							lck.lock();
+						}
+						else
+						{
+							w.conn = conn;
+						}
+						break;
+					}
+
+					lck.lock();
+				}
+
+				if (w.cv.wait_until(lck, deadline) == std::cv_status::timeout)
+					break;
+			}
+
+			_remove_waiter(&w);
+
+			return w.conn;
+		}
+
+		void _remove_waiter(waiter * w)
+		{
+			auto it = std::find(m_waiters.begin(), m_waiters.end(), w);
+			if (it != m_waiters.end())
+				m_waiters.erase(it);
+			m_waiting_count--;
+		}
+
+		/**
+		 * hand the connection to the oldest waiter,must be called when m_wait_mtx is locked and the
+		 * waiting queue is not empty.a parked waiter is notified here,a async waiter is returned and
+		 * must be completed by _complete after m_wait_mtx is unlocked.
+		 */
+		waiter * _handoff(connection_type * conn)
+		{
+			waiter * w = m_waiters.front();
+			m_waiters.pop_front();
+
+			w->conn = conn;
+
+			if (!w->callback)
+			{
+				// the parked waiter may leave as soon as m_wait_mtx is unlocked,so don't touch it later
+				w->cv.notify_one();
+				return nullptr;
+			}
+
+			return w;
+		}
+
+		/**
+		 * complete a async waiter,the callback is called without any lock.
+		 */
+		void _complete(waiter * w)
+		{
+			m_waiting_count--;
+
+			std::function<void(std::shared_ptr<connection_type>)> callback = std::move(w->callback);
+			connection_type * conn = w->conn;
+			auto start_time = w->start_time;
+
+			delete w;
+
+			// the callback may release the connection at once,then the next async waiter will be completed
+			// in the callback call stack,so queue the nested completions and call them one by one,otherwise
+			// the stack will grow with the count of waiters.
+			typedef std::pair<std::function<void(std::shared_ptr<connection_type>)>, std::shared_ptr<connection_type>> completion;
+			static thread_local std::deque<completion> * pending = nullptr;
+
+			if (pending)
+			{
+				pending->emplace_back(std::move(callback), _wrap(conn, start_time));
+				return;
+			}
+
+			std::deque<completion> completions;
+			pending = &completions;
+
+			try
+			{
+				callback(_wrap(conn, start_time));
+
+				while (!completions.empty())
+				{
+					completion c = std::move(completions.front());
+					completions.pop_front();
+					c.first(std::move(c.second));
+				}
+			}
+			catch (...)
+			{
+				pending = nullptr;
+				throw;
+			}
+
+			pending = nullptr;
+		}
+
+		/**
+		 * wake up the oldest waiter to try create a new connection,called after a connection is destroyed.
+		 */
+		void _notify_waiter()
+		{
+			if (m_waiting_count.load() > 0)
+			{
+				{
+					std::lock_guard<std::mutex> g(m_wait_mtx);
+					if (m_waiters.empty())
+						return;
+					if (!m_waiters.front()->callback)
+					{
+						m_waiters.front()->cv.notify_one();
+						return;
+					}
+				}
+
+				// a async waiter can't create the connection by itself,so create it here
+				connection_type * conn = nullptr;
+				try
+				{
+					conn = _create_connection();
+				}
+				catch (...)
+				{
+				}
+
+				if (conn)
+					_dispatch(conn);
+			}
+		}
+
+		/**
+		 * return the connection to the pool,called by the connection shared_ptr deleter.
+		 */
+		void _release(connection_type * conn)
+		{
+			auto hold_time = std::chrono::steady_clock::now() - conn->m_acquire_time;
+
+			m_hold_histogram.record((std::uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(hold_time).count());
+
+			if (m_on_release)
+				m_on_release(*conn, hold_time);
+
+			conn->_recycle();
+
+			m_using_count--;
+
+			conn->m_last_access_time = std::chrono::system_clock::now();
+
+			_dispatch(conn);
+		}
+
+		/**
+		 * hand the connection to the oldest waiter,or put it into the idle queue if nobody is waiting.
+		 */
+		void _dispatch(connection_type * conn)
+		{
+			// hand the connection straight to the oldest waiter,without a round trip through the idle queue
+			if (m_waiting_count.load() > 0)
+			{
+				bool handed = false;
+				waiter * w = nullptr;
+				{
+					std::lock_guard<std::mutex> g(m_wait_mtx);
+					if (!m_waiters.empty())
+					{
+						w = _handoff(conn);
+						handed = true;
+					}
+				}
+				if (handed)
+				{
+					if (w)
+						_complete(w);
+					return;
+				}
+			}
+
+			_push_idle(conn);
+
+			// a waiter may be enqueued after we checked the m_waiting_count above but before we pushed 
+			// the connection to the idle queue,then it may miss the connection,so check it again.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			while (m_waiting_count.load() > 0)
+			{
+				waiter * w = nullptr;
+				{
+					std::lock_guard<std::mutex> g(m_wait_mtx);
+					if (m_waiters.empty() || !m_connections.try_pop(conn))
+						break;
+					w = _handoff(conn);
+				}
+				if (w)
+					_complete(w);
+			}
+		}
+
+		void _push_idle(connection_type * conn)
+		{
+			// the queue capacity is not less than m_max_conn_count,so it can't be full in fact
+			if (!m_connections.try_push(conn))
+			{
+				delete conn;
+				m_conn_count--;
+				m_closed_error_counter.add();
+				_notify_waiter();
+			}
+		}
+
+		/**
+		 * create a new connection if the total count of connections is less than m_max_conn_count.
+		 */
+		connection_type * _create_connection()
+		{
+			std::size_t count = m_conn_count.load();
+			while (count < m_max_conn_count)
+			{
+				if (m_conn_count.compare_exchange_weak(count, count + 1))
+				{
+					connection_type * conn = nullptr;
+					try
+					{
+						conn = new_connection();
+					}
+					catch (...)
+					{
+						m_conn_count--;
+						m_connect_failed_counter.add();
+						throw;
+					}
+
+					if (conn)
+					{
+						m_created_counter.add();
+					}
+					else
+					{
+						m_conn_count--;
+						m_connect_failed_counter.add();
+					}
+
+					return conn;
+				}
+			}
+			return nullptr;
+		}
+
+		connection_type * new_connection()
+		{
+			return Backend::create(m_url_ptr, m_execute_timeout);
+		}
+
+	protected:
+
+		std::shared_ptr<url> m_url_ptr;
+
+		/// lock used to serialize the pool reap and destroy,the get,release and warm-up don't use it
+		spin_lock m_lock;
+
+		/// below three members used to safe destroy the pool and exit
+		volatile bool m_stopped = false;
+		std::mutex m_mtx;
+		std::condition_variable m_cv;
+
+		/// the thread shared_ptr of reap the connections
+		std::shared_ptr<std::thread> m_sweep_thread_ptr;
+
+		/// the thread shared_ptr of fill the pool in lazy warmup mode
+		std::shared_ptr<std::thread> m_warmup_thread_ptr;
+
+		/// the first error of opening the initial connections,see get_warmup_error
+		std::exception_ptr m_warmup_error;
+		std::mutex m_warmup_mtx;
+
+		/// idle connections,bounded deques sharded per thread,popped LIFO by the own thread
+		sharded_queue<connection_type *> m_connections;
+
+		/// using count of connections
+		std::atomic<std::size_t> m_using_count{ 0 };
+
+		/// total count of connections (idle and using)
+		std::atomic<std::size_t> m_conn_count{ 0 };
+
+		/// FIFO queue of the callers waiting for a connection,guarded by m_wait_mtx
+		std::mutex m_wait_mtx;
+		std::deque<waiter *> m_waiters;
+
+		/// waiting count of callers,can be read without lock
+		std::atomic<std::size_t> m_waiting_count{ 0 };
+
+		std::size_t m_init_conn_count = zdb2::DEFAULT_INIT_CONNECTIONS;
+		std::size_t m_conn_timeout    = zdb2::DEFAULT_CONNECTION_TIMEOUT;
+		std::size_t m_execute_timeout = zdb2::DEFAULT_TIMEOUT;
+		std::size_t m_max_conn_count  = zdb2::DEFAULT_MAX_CONNECTIONS;
+		std::size_t m_sweep_interval  = zdb2::DEFAULT_SWEEP_INTERVAL;
+
+		warmup_mode m_warmup          = warmup_mode::serial;
+		std::size_t m_warmup_threads  = zdb2::DEFAULT_WARMUP_THREADS;
+
+		/// elastic sizing policy settings,see set_elastic
+		std::atomic<bool>        m_elastic{ false };
+		std::atomic<std::size_t> m_min_idle{ zdb2::DEFAULT_MIN_IDLE_CONNECTIONS };
+		std::size_t              m_elastic_interval = zdb2::DEFAULT_ELASTIC_INTERVAL;
+
+		/// acquisitions and the sum of their waiting time at the last sample,only touched by the sweep thread
+		std::uint64_t m_last_acquire_count = 0;
+		std::uint64_t m_last_acquire_wait  = 0;
+
+		/// moving averages of the load,only touched by the sweep thread
+		ewma m_utilization_ewma{ zdb2::DEFAULT_ELASTIC_ALPHA };
+		ewma m_demand_ewma{ zdb2::DEFAULT_ELASTIC_ALPHA };
+		ewma m_waiting_ewma{ zdb2::DEFAULT_ELASTIC_ALPHA };
+		ewma m_latency_ewma{ zdb2::DEFAULT_ELASTIC_ALPHA };
+
+		/// snapshot of the moving averages for get_elastic_stats,guarded by m_elastic_mtx
+		std::mutex m_elastic_mtx;
+		elastic_stats m_elastic_stats;
+
+		/// statistics of the reaper,guarded by m_sweep_mtx
+		std::mutex m_sweep_mtx;
+		sweep_stats m_sweep_stats;
+
+		/// metrics counters,see get_stats
+		striped_counter<> m_acquire_counter;
+		striped_counter<> m_acquire_failed_counter;
+		striped_counter<> m_created_counter;
+		striped_counter<> m_connect_failed_counter;
+		striped_counter<> m_closed_timeout_counter;
+		striped_counter<> m_closed_ping_counter;
+		striped_counter<> m_closed_error_counter;
+		striped_counter<> m_closed_shrink_counter;
+
+		/// acquisition waiting time and holding time in microseconds
+		histogram m_wait_histogram;
+		histogram m_hold_histogram;
+
+		acquire_hook m_on_acquire;
+		release_hook m_on_release;
+
+		/// the query result cache of cached_select,see enable_query_cache
+		std::shared_ptr<query_cache> m_query_cache;
+
+		/// the statement tracer of the connections,see enable_tracing
+		std::shared_ptr<tracer> m_tracer;
+
+		/// the writer of group_exec,see enable_group_commit
+		std::shared_ptr<group_commit> m_group_commit;
+
+	};
+
+}
@@ -0,0 +1,222 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <zdb2/config.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the value type of a column_buffer,the column values are converted to it by the backend.
+	 */
+	enum class column_type
+	{
+		int64,
+		real,
+		text,
+		blob,
+	};
+
+	/**
+	 * the values of one column of several rows filled by resultset::fetch_batch.the numbers are
+	 * stored in a contiguous array,the texts and blobs in one byte array with the offsets of the
+	 * rows,and the SQL NULL values in a bitmap,so the values can be processed in a tight loop.
+	 * the buffer is cleared by every fetch_batch,but its memory is kept for the next batch.
+	 */
+	class column_buffer
+	{
+	public:
+		explicit column_buffer(column_type type = column_type::text) : m_type(type)
+		{
+			m_offsets.push_back(0);
+		}
+
+		~column_buffer()
+		{
+		}
+
+		column_type get_type() const
+		{
+			return m_type;
+		}
+
+		/**
+		 * Returns the number of rows in the buffer.
+		 */
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return (m_size == 0);
+		}
+
+		void clear()
+		{
+			m_size = 0;
+			m_int64s.clear();
+			m_doubles.clear();
+			m_offsets.resize(1);
+			m_bytes.clear();
+			m_nulls.clear();
+		}
+
+		void reserve(std::size_t rows)
+		{
+			switch (m_type)
+			{
+			case column_type::int64: m_int64s.reserve(rows); break;
+			case column_type::real:  m_doubles.reserve(rows); break;
+			default:                 m_offsets.reserve(rows + 1); break;
+			}
+			m_nulls.reserve((rows + 63) / 64);
+		}
+
+		/** @name Values */
+		//@{
+
+		bool is_null(std::size_t row) const
+		{
+			return ((m_nulls[row / 64] >> (row % 64)) & 1) != 0;
+		}
+
+		/// the value of a NULL row is 0
+		int64_t get_int64(std::size_t row) const
+		{
+			return m_int64s[row];
+		}
+
+		/// the value of a NULL row is 0
+		double get_double(std::size_t row) const
+		{
+			return m_doubles[row];
+		}
+
+		/**
+		 * Returns the text or blob of the row,it is not null terminated.
+		 * @param size The number of bytes of the value,0 for a NULL row
+		 */
+		const char * get_bytes(std::size_t row, std::size_t * size) const
+		{
+			if (size)
+				*size = m_offsets[row + 1] - m_offsets[row];
+			return m_bytes.data() + m_offsets[row];
+		}
+
+		/// the values of a int64 column,one per row
+		const int64_t * int64_data() const
+		{
+			return m_int64s.data();
+		}
+
+		/// the values of a real column,one per row
+		const double * double_data() const
+		{
+			return m_doubles.data();
+		}
+
+		/// the offsets of the rows in bytes_data of a text or blob column,size() + 1 elements
+		const std::size_t * offsets_data() const
+		{
+			return m_offsets.data();
+		}
+
+		/// the bytes of all the rows of a text or blob column
+		const char * bytes_data() const
+		{
+			return m_bytes.data();
+		}
+
+		/// the bit (row % 64) of the word (row / 64) is 1 if the row is SQL NULL
+		const std::uint64_t * null_bitmap() const
+		{
+			return m_nulls.data();
+		}
+
+		//@}
+
+		/** @name Append,used by the backends */
+		//@{
+
+		void push_null()
+		{
+			switch (m_type)
+			{
+			case column_type::int64: m_int64s.push_back(0); break;
+			case column_type::real:  m_doubles.push_back(0); break;
+			default:                 m_offsets.push_back(m_bytes.size()); break;
+			}
+			_push_null_bit(true);
+		}
+
+		void push_int64(int64_t x)
+		{
+			m_int64s.push_back(x);
+			_push_null_bit(false);
+		}
+
+		void push_double(double x)
+		{
+			m_doubles.push_back(x);
+			_push_null_bit(false);
+		}
+
+		void push_bytes(const void * x, std::size_t size)
+		{
+			if (x && size > 0)
+			{
+				std::size_t pos = m_bytes.size();
+				m_bytes.resize(pos + size);
+				std::memcpy(&m_bytes[pos], x, size);
+			}
+			m_offsets.push_back(m_bytes.size());
+			_push_null_bit(false);
+		}
+
+		//@}
+
+	protected:
+
+		void _push_null_bit(bool null)
+		{
+			if (m_size % 64 == 0)
+				m_nulls.push_back(0);
+			if (null)
+				m_nulls.back() |= (std::uint64_t(1) << (m_size % 64));
+			m_size++;
+		}
+
+	protected:
+
+		column_type m_type = column_type::text;
+
+		std::size_t m_size = 0;
+
+		std::vector<int64_t> m_int64s;
+
+		std::vector<double> m_doubles;
+
+		std::vector<std::size_t> m_offsets;
+
+		std::vector<char> m_bytes;
+
+		std::vector<std::uint64_t> m_nulls;
+	};
+
+}
@@ -0,0 +1,98 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+
+#include <zdb2/config.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * a column resolved by its name once,see resultset::column and column_of.it converts to the
+	 * column index,so it is passed to the getters by index without a name lookup for every row.
+	 * the index is valid for every resultset of the same sql,so a handle can be kept and reused
+	 * across the executions of a statement.
+	 * eg : auto name = rs->column("name"); while (rs->next_row()) rs->get_string(name);
+	 */
+	class column_handle
+	{
+	public:
+		constexpr column_handle() : m_index(-1)
+		{
+		}
+
+		constexpr explicit column_handle(int index) : m_index(index)
+		{
+		}
+
+		constexpr int index() const
+		{
+			return m_index;
+		}
+
+		/**
+		 * Returns false if the column name was not found.
+		 */
+		constexpr bool valid() const
+		{
+			return (m_index >= 0);
+		}
+
+		constexpr explicit operator bool() const
+		{
+			return (m_index >= 0);
+		}
+
+		constexpr operator int() const
+		{
+			return m_index;
+		}
+
+	protected:
+
+		int m_index;
+	};
+
+	/**
+	 * Returns true if the two NUL terminated names are equal,can be evaluated at compile time.
+	 */
+	constexpr bool column_name_equal(const char * a, const char * b)
+	{
+		return (*a == *b) && (*a == '\0' || column_name_equal(a + 1, b + 1));
+	}
+
+	constexpr int _column_index_of(const char * name, const char * const * names, std::size_t count, std::size_t i)
+	{
+		return (i >= count) ? throw std::logic_error("column name is not found.") :
+			(column_name_equal(name, names[i]) ? (int)i : _column_index_of(name, names, count, i + 1));
+	}
+
+	/**
+	 * Resolve the column by its name in a list of the selected column names at compile time,a
+	 * unknown name is a compile error when the result is constexpr. The list must be in the
+	 * order of the columns of the query.
+	 * eg : static constexpr const char * cols[] = { "id", "name" };
+	 *      constexpr zdb2::column_handle name = zdb2::column_of("name", cols);
+	 *      auto rs = conn->select("select id,name from t"); ... rs->get_string(name);
+	 * @param name The column name. <i>case-sensitive</i>
+	 * @param names The column names of the query
+	 * @return The column handle
+	 */
+	template<std::size_t N>
+	constexpr column_handle column_of(const char * name, const char * const (&names)[N])
+	{
+		return column_handle(_column_index_of(name, names, N, 0));
+	}
+
+}
@@ -11,6 +11,8 @@
 #pragma once
 
 #include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <memory>
 #include <algorithm>
@@ -18,17 +20,28 @@
 #include <atomic>
 #include <chrono>
 #include <stdexcept>
+#include <vector>
+#include <tuple>
+#include <iterator>
+#include <type_traits>
 
 #include <zdb2/config.hpp>
 #include <zdb2/net/url.hpp>
 #include <zdb2/db/stmt.hpp>
 #include <zdb2/db/resultset.hpp>
+#include <zdb2/db/stmt_cache.hpp>
+#include <zdb2/db/query_cache.hpp>
+#include <zdb2/db/tracer.hpp>
 
 namespace zdb2
 {
 
+	template<class Backend> class basic_pool;
+
 	class connection
 	{
+		template<class Backend> friend class basic_pool;
+
 	public:
 		connection(
 			std::shared_ptr<url> url_ptr,
@@ -37,7 +50,11 @@ namespace zdb2
 			: m_url_ptr(url_ptr)
 			, m_transaction(0)
 			, m_timeout(timeout)
+			, m_default_timeout(timeout)
 		{
+			std::string size = m_url_ptr->get_param_value("stmt-cache");
+			if (!size.empty() && std::atoi(size.c_str()) >= 0)
+				m_stmt_cache.set_capacity((std::size_t)std::atoi(size.c_str()));
 		}
 
 		virtual ~connection()
@@ -60,6 +77,38 @@ namespace zdb2
 		}
 
 
+		/**
+		 * Return the time the last borrower waited for this Connection when it
+		 * was taken from the Connection Pool. 
+		 * @param C A Connection object
+		 * @return The waiting time of the last acquisition
+		 */
+		std::chrono::steady_clock::duration get_acquire_wait_time()
+		{
+			return m_acquire_wait_time;
+		}
+
+
+		/**
+		 * Return the statistics of the prepared statement cache of this Connection,
+		 * the cache lives as long as the Connection,so the statements prepared by
+		 * the previous borrowers are reused.The cache size can be set by the url
+		 * parameter "stmt-cache=32",zero disables the cache.
+		 * @param C A Connection object
+		 * @return The hits,misses and evictions of the statement cache
+		 */
+		stmt_cache_stats get_stmt_cache_stats()
+		{
+			stmt_cache_stats s;
+			s.hits      = m_stmt_cache.get_hits();
+			s.misses    = m_stmt_cache.get_misses();
+			s.evictions = m_stmt_cache.get_evictions();
+			s.size      = m_stmt_cache.size();
+			s.capacity  = m_stmt_cache.get_capacity();
+			return s;
+		}
+
+
 		/**
 		 * Return true if this Connection is in a transaction that has not
 		 * been committed.
@@ -87,7 +136,7 @@ namespace zdb2
 		 * @param ms The query timeout limit in milliseconds; zero means
 		 * there is no limit
 		 */
-		void set_query_timeout(std::size_t ms)
+		virtual void set_query_timeout(std::size_t ms)
 		{
 			m_timeout = ms;
 		}
@@ -147,6 +196,19 @@ namespace zdb2
 		virtual void close() = 0;
 
 
+		/**
+		 * Cancel the SQL statement which is running on this Connection,it can
+		 * be called from another thread. The statement fails with an error in
+		 * the thread which runs it,the Connection is still usable and goes
+		 * back to the Connection Pool as usual. Nothing is cancelled if no 
+		 * statement is running.
+		 * @param C A Connection object
+		 */
+		virtual void cancel()
+		{
+		}
+
+
 		/**
 		 * Start a transaction. 
 		 * @param C A Connection object
@@ -282,6 +344,163 @@ namespace zdb2
 		virtual const char * get_last_error() = 0;
 
 
+		/**
+		 * Executes the given SQL statement with the parameters,which may be an 
+		 * INSERT, UPDATE,or DELETE statement. The parameters are bound to the '?'
+		 * placeholders in order by their types at compile time (see stmt::bind),
+		 * and the statement is prepared once and reused from the statement cache,
+		 * so the values are never formatted into the sql text.
+		 * eg : conn->exec("update t set x=? where id=?", 12.34, id);
+		 * @param C A Connection object
+		 * @param sql A single SQL statement with '?' IN parameter placeholders
+		 * @return The number of rows changed by the statement
+		 * @exception SQLException If a database error occurs. 
+		 */
+		template<typename... Args>
+		int64_t exec(const char * sql, const Args&... args)
+		{
+			std::shared_ptr<stmt> s = _prepare(sql);
+
+			s->bind_all(args...);
+			s->execute();
+
+			return s->rows_changed();
+		}
+
+
+		/**
+		 * Executes the given SQL query with the parameters,which returns a single 
+		 * ResultSet object,see exec. The ResultSet keeps its statement,the same sql
+		 * executed while the ResultSet is alive is prepared by a new statement.
+		 * The string and blob arguments are copied,so they may be temporaries.
+		 * eg : auto rs = conn->select("select * from t where id=?", id);
+		 * @param C A Connection object
+		 * @param sql A single SQL statement with '?' IN parameter placeholders
+		 * @return A ResultSet object that contains the data produced by the query
+		 * @exception SQLException If a database error occurs. 
+		 */
+		template<typename... Args>
+		std::shared_ptr<resultset> select(const char * sql, const Args&... args)
+		{
+			std::shared_ptr<stmt> s = _prepare(sql);
+
+			s->m_copy_params = true;
+			try
+			{
+				s->bind_all(args...);
+			}
+			catch (...)
+			{
+				s->m_copy_params = false;
+				throw;
+			}
+			s->m_copy_params = false;
+
+			return s->query();
+		}
+
+
+		/**
+		 * Inserts the rows into the table,a row is a std::tuple of the column values
+		 * in the order of the columns. The rows are inserted in a transaction unless
+		 * this Connection is already in one,and sent in as few round trips as the
+		 * backend allows : SQLite prepares one statement and runs it for every row,MySQL
+		 * sends multi-row VALUES statements up to the max_allowed_packet of the server.
+		 * The rows must be a container,the values are not copied.
+		 * eg : conn->insert_many("t", { "id","name" }, rows);
+		 * @param C A Connection object
+		 * @param table The table name
+		 * @param columns The column names
+		 * @param rows A container of std::tuple
+		 * @return The number of rows inserted
+		 * @exception SQLException If a database error occurs,the transaction
+		 * started by this method is rolled back.
+		 */
+		template<typename Rows>
+		int64_t insert_many(const char * table, const std::vector<std::string> & columns, const Rows & rows)
+		{
+			typedef typename std::decay<decltype(*std::begin(rows))>::type row_type;
+
+			if (!table || table[0] == '\0' || columns.empty())
+				throw std::runtime_error("invalid parameters.");
+
+			if (std::tuple_size<row_type>::value != columns.size())
+				throw std::runtime_error("the column count don't match the row.");
+
+			std::size_t max_rows = 1, max_bytes = 0;
+			_batch_limits(columns.size(), max_rows, max_bytes);
+			if (max_rows < 1)
+				max_rows = 1;
+
+			// "insert into t (a,b) values " and the placeholders of a row "(?,?)"
+			std::string sql = "insert into ";
+			sql += table;
+			sql += " (";
+			std::string values = "(";
+			for (std::size_t i = 0; i < columns.size(); i++)
+			{
+				sql += (i == 0 ? "" : ",");
+				sql += columns[i];
+				values += (i == 0 ? "?" : ",?");
+			}
+			sql += ") values ";
+			values += ")";
+
+			bool owned = !is_intransaction();
+			if (owned && !begin_transaction())
+				throw std::runtime_error(get_last_error());
+
+			int64_t changed = 0;
+
+			// the statement of the full chunks is prepared once and reused for all of them,the other chunk
+			// sizes (the last chunk,or a chunk cut by max_bytes) are one-off,so they are not cached
+			std::shared_ptr<stmt> full, other;
+			std::size_t full_rows = 0, other_rows = 0;
+
+			try
+			{
+				std::vector<const row_type *> chunk;
+				chunk.reserve(max_rows);
+				std::size_t bytes = 0;
+
+				auto flush = [&]()
+				{
+					if (chunk.size() == max_rows)
+						changed += _insert_chunk(sql, values, chunk, full, full_rows, true);
+					else
+						changed += _insert_chunk(sql, values, chunk, other, other_rows, false);
+					chunk.clear();
+					bytes = 0;
+				};
+
+				for (const auto & row : rows)
+				{
+					std::size_t size = (max_bytes > 0 ? _row_size<0>(row) : 0);
+
+					if (!chunk.empty() && (chunk.size() >= max_rows || (max_bytes > 0 && bytes + size > max_bytes)))
+						flush();
+
+					chunk.push_back(&row);
+					bytes += size;
+				}
+
+				if (!chunk.empty())
+					flush();
+
+				if (owned && !commit())
+					throw std::runtime_error(get_last_error());
+			}
+			catch (...)
+			{
+				if (owned)
+					rollback();
+				throw;
+			}
+
+			return changed;
+		}
+
+
 		/** @name Class methods */
 		//@{
 
@@ -300,6 +519,277 @@ namespace zdb2
 	protected:
 		virtual bool _init() = 0;
 
+		/**
+		 * prepare the sql without formatting it,from the statement cache if the backend supports it.
+		 */
+		virtual std::shared_ptr<stmt> _prepare_cached(const char * sql)
+		{
+			return prepare_stmt("%s", sql);
+		}
+
+		/**
+		 * prepare the sql without formatting it,and without putting it into the statement cache,for the
+		 * one-off statements which would push the useful ones out of the cache.
+		 */
+		virtual std::shared_ptr<stmt> _prepare_new(const char * sql)
+		{
+			return _prepare_cached(sql);
+		}
+
+		std::shared_ptr<stmt> _prepare(const char * sql, bool cached = true)
+		{
+			if (!sql || sql[0] == '\0')
+				throw std::runtime_error("invalid parameters.");
+
+			std::shared_ptr<stmt> s = (cached ? _prepare_cached(sql) : _prepare_new(sql));
+			if (!s || !s->is_prepared())
+				throw std::runtime_error(get_last_error());
+
+			return s;
+		}
+
+		/**
+		 * invalidate the cached query results of the tables written by the statement when it is executed,
+		 * and trace the executions of it by the tracer of this connection.
+		 */
+		void _listen(stmt & s)
+		{
+			s.m_tracer = &m_tracer;
+
+			std::vector<std::string> tables;
+			if (query_cache::parse_tables(s.get_sql().c_str(), tables) && !tables.empty())
+			{
+				s.m_on_execute = [this, tables]()
+				{
+					_on_write(tables);
+				};
+			}
+		}
+
+		void _on_write(const char * sql)
+		{
+			if (m_query_cache)
+			{
+				std::vector<std::string> tables;
+				if (query_cache::parse_tables(sql, tables))
+					_on_write(tables);
+			}
+		}
+
+		/**
+		 * the results are invalidated at once,and again by the commit,because a query of another
+		 * connection may cache the rows it read before the commit.
+		 */
+		void _on_write(const std::vector<std::string> & tables)
+		{
+			if (!m_query_cache)
+				return;
+
+			if (!is_intransaction())
+			{
+				m_query_cache->invalidate(tables);
+				return;
+			}
+
+			// a transaction writes the same tables again and again,invalidate them once
+			bool found = true;
+			for (auto & table : tables)
+			{
+				if (std::find(m_written_tables.begin(), m_written_tables.end(), table) == m_written_tables.end())
+				{
+					m_written_tables.push_back(table);
+					found = false;
+				}
+			}
+			if (!found)
+				m_query_cache->invalidate(tables);
+		}
+
+		void _on_commit()
+		{
+			if (m_query_cache && !m_written_tables.empty())
+				m_query_cache->invalidate(m_written_tables);
+			m_written_tables.clear();
+		}
+
+		void _on_rollback()
+		{
+			m_written_tables.clear();
+		}
+
+		/**
+		 * add the time of the prepare to the trace of the first execution of the statement.
+		 * @param start When the prepare began
+		 */
+		void _trace_prepare(stmt & s, std::chrono::steady_clock::time_point start)
+		{
+			s.m_span.prepare_time += trace_span::elapsed(start);
+		}
+
+		/**
+		 * record a execution of the sql by execute,or a query or a prepare which failed,see tracer.
+		 * @param start When the execution began
+		 * @param error The execution failed
+		 */
+		void _trace_execute(tracer & t, std::chrono::steady_clock::time_point start, const char * sql, bool error = false)
+		{
+			trace_span span;
+			span.execute_time = trace_span::elapsed(start);
+			span.error = error;
+			t.begin(span, sql);
+			t.finish(span, [sql]()
+			{
+				return std::string(sql);
+			});
+		}
+
+		/**
+		 * pass the trace of the query to the resultset,which records it after the rows are fetched.
+		 * @param prepare_start When the prepare began
+		 * @param execute_start When the execution began,after the prepare
+		 */
+		void _trace_query(tracer & t, std::chrono::steady_clock::time_point prepare_start,
+			std::chrono::steady_clock::time_point execute_start, const char * sql, resultset & rs)
+		{
+			rs.m_span.prepare_time = (std::uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				execute_start - prepare_start).count();
+			rs.m_span.execute_time = trace_span::elapsed(execute_start);
+			t.begin(rs.m_span, sql);
+			if (t.has_slow_query_sink())
+				rs.m_span.expanded_sql = sql;
+			rs.m_tracer = m_tracer;
+		}
+
+		/**
+		 * make the connection clean before it is returned to the pool,the transaction left open by the
+		 * borrower (eg : the statement was cancelled or threw) is rolled back,and the query timeout set
+		 * by the borrower is restored,so the next borrower don't inherit it.
+		 */
+		virtual void _reset()
+		{
+			if (is_intransaction())
+				rollback();
+
+			if (m_timeout != m_default_timeout)
+				set_query_timeout(m_default_timeout);
+		}
+
+		/**
+		 * called by the pool when the connection is returned,it never throws.
+		 */
+		void _recycle()
+		{
+			try
+			{
+				_reset();
+			}
+			catch (...)
+			{
+			}
+		}
+
+		/**
+		 * the limits of one INSERT statement of insert_many,the rows are inserted one by one by default.
+		 * @param max_rows the maximum number of rows in one statement
+		 * @param max_bytes the maximum number of bytes of the values in one statement,zero is unlimited
+		 */
+		virtual void _batch_limits(std::size_t, std::size_t & max_rows, std::size_t & max_bytes)
+		{
+			max_rows = 1;
+			max_bytes = 0;
+		}
+
+		/**
+		 * insert the rows by one statement,the statement s is reused if it has the same row count,
+		 * otherwise a new one is prepared and kept in s.
+		 */
+		template<typename Row>
+		int64_t _insert_chunk(const std::string & head, const std::string & values, const std::vector<const Row *> & chunk,
+			std::shared_ptr<stmt> & s, std::size_t & s_rows, bool cached)
+		{
+			if (s && s_rows == chunk.size())
+			{
+				s->reset();
+			}
+			else
+			{
+				std::string sql = head;
+				sql.reserve(head.size() + (values.size() + 1) * chunk.size());
+				for (std::size_t i = 0; i < chunk.size(); i++)
+				{
+					if (i > 0)
+						sql += ",";
+					sql += values;
+				}
+
+				s = _prepare(sql.c_str(), cached);
+				s_rows = chunk.size();
+			}
+
+			if (chunk.size() == 1)
+			{
+				s->bind_row(*chunk[0]);
+			}
+			else
+			{
+				int param_index = 1;
+				for (const Row * row : chunk)
+				{
+					s->bind_row(*row, param_index);
+					param_index += (int)std::tuple_size<Row>::value;
+				}
+			}
+
+			s->execute();
+
+			return s->rows_changed();
+		}
+
+		/// the approximate size in bytes of the values of a row sent to the server,every value has 
+		/// 2 bytes of type,and a string has a length prefix of up to 9 bytes
+		template<std::size_t I, typename... Args>
+		static typename std::enable_if<(I == sizeof...(Args)), std::size_t>::type _row_size(const std::tuple<Args...> &)
+		{
+			return 0;
+		}
+
+		template<std::size_t I, typename... Args>
+		static typename std::enable_if<(I < sizeof...(Args)), std::size_t>::type _row_size(const std::tuple<Args...> & row)
+		{
+			return _value_size(std::get<I>(row)) + _row_size<I + 1>(row);
+		}
+
+		template<typename T>
+		static typename std::enable_if<std::is_arithmetic<T>::value, std::size_t>::type _value_size(T)
+		{
+			return sizeof(T) + 2;
+		}
+
+		static std::size_t _value_size(const char * x)
+		{
+			return (x ? std::strlen(x) : 0) + 11;
+		}
+
+		static std::size_t _value_size(const std::string & x)
+		{
+			return x.size() + 11;
+		}
+
+		static std::size_t _value_size(std::nullptr_t)
+		{
+			return 2;
+		}
+
+		static std::size_t _value_size(const blob & x)
+		{
+			return x.size + 11;
+		}
+
+		static std::size_t _value_size(const timestamp &)
+		{
+			return 16;
+		}
+
 		virtual bool _connect() = 0;
 
 	protected:
@@ -308,12 +798,33 @@ namespace zdb2
 
 		std::size_t m_timeout  = zdb2::DEFAULT_TIMEOUT;
 
+		/// the query timeout of the pool,restored when the connection is returned
+		std::size_t m_default_timeout = zdb2::DEFAULT_TIMEOUT;
+
 		int m_last_error = 0;
 
 		std::atomic_int m_transaction;
 
 		/// c++ 11 time,http://blog.csdn.net/oncealong/article/details/28599655
 		std::chrono::system_clock::time_point m_last_access_time = std::chrono::system_clock::now();
+
+		/// how long the last borrower waited for this connection in the pool
+		std::chrono::steady_clock::duration m_acquire_wait_time = std::chrono::steady_clock::duration::zero();
+
+		/// when the last borrower got this connection from the pool
+		std::chrono::steady_clock::time_point m_acquire_time;
+
+		/// prepared statements keyed by the sql text
+		stmt_cache m_stmt_cache;
+
+		/// the query result cache of the pool,set when this connection is got from the pool
+		std::shared_ptr<query_cache> m_query_cache;
+
+		/// the tables written in the current transaction
+		std::vector<std::string> m_written_tables;
+
+		/// the statement tracer of the pool,set when this connection is got from the pool
+		std::shared_ptr<tracer> m_tracer;
 	};
 
 }
@@ -0,0 +1,356 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <zdb2/config.hpp>
+#include <zdb2/db/connection.hpp>
+#include <zdb2/db/stored_args.hpp>
+#include <zdb2/db/writer_queue.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the statistics of the group commit writer,see pool::get_group_commit_stats.
+	 */
+	struct group_commit_stats
+	{
+		/// the writes done,successful or not
+		std::uint64_t writes = 0;
+
+		/// the transactions committed,writes / batches is the average batch size
+		std::uint64_t batches = 0;
+
+		/// the writes which failed,the rest of their batches were run again without them
+		std::uint64_t errors = 0;
+
+		/// the batches which failed to begin or commit,all the writes of them failed
+		std::uint64_t failed_batches = 0;
+	};
+
+	/**
+	 * the group commit writer : the small writes of many threads are queued,and a writer thread gathers
+	 * them over a short window or up to a count,and runs them in one transaction on one connection,so
+	 * there is one commit (one fsync of SQLite,one redo log flush of MySQL) for the whole batch instead
+	 * of one per write.Every write gets a future of its own result.
+	 * When a write fails,the transaction is rolled back,the write gets its error,and the other writes of
+	 * the batch are run again in a new transaction,so a bad write never fails or loses the others.The
+	 * writes of a batch may run more than once,so only the plain SQL statements are accepted,and a write
+	 * is only visible after the batch is committed.
+	 */
+	class group_commit
+	{
+	public:
+		/// get a connection in the timeout,returns nullptr or throws if none is available
+		typedef std::function<std::shared_ptr<connection>(std::chrono::milliseconds)> acquire_handler;
+
+		/**
+		 * @param acquire Get the connection of a batch
+		 * @param window How long the writer waits for more writes after the first one of a batch,zero
+		 * only batches the writes which are already queued
+		 * @param max_batch The maximum number of writes in one transaction
+		 * @param timeout The millisecond timeout of getting a connection
+		 * @param queue_size The capacity of the write queue,the callers wait while it is full
+		 */
+		group_commit(
+			acquire_handler acquire,
+			std::chrono::milliseconds window = std::chrono::milliseconds(zdb2::DEFAULT_GROUP_COMMIT_WINDOW),
+			std::size_t max_batch            = zdb2::DEFAULT_GROUP_COMMIT_SIZE,
+			std::size_t timeout              = zdb2::DEFAULT_TIMEOUT,
+			std::size_t queue_size           = zdb2::DEFAULT_WRITE_QUEUE_SIZE
+		)
+			: m_acquire(std::move(acquire))
+			, m_window(window)
+			, m_max_batch(max_batch > 0 ? max_batch : 1)
+			, m_timeout(timeout)
+			, m_queue(queue_size)
+		{
+			m_thread = std::thread([this]()
+			{
+				_run();
+			});
+		}
+
+		~group_commit()
+		{
+			stop();
+		}
+
+		/**
+		 * Queue the SQL statement with the parameters,it is executed by connection::exec in the next
+		 * batch.The parameters are copied,the strings and the blobs don't need to live until it is done.
+		 * @param sql A single INSERT,UPDATE,DELETE or REPLACE statement with '?' IN parameter placeholders
+		 * @return The future of the number of rows changed by the statement,it holds the exception of the
+		 * statement,or of the batch if the batch failed to begin or commit
+		 * @exception SQLException If the writer is stopped
+		 */
+		template<typename... Args>
+		std::future<int64_t> exec(const char * sql, const Args&... args)
+		{
+			if (!sql || sql[0] == '\0')
+				throw std::runtime_error("invalid parameters.");
+
+			write_impl<typename std::decay<Args>::type...> * w =
+				new write_impl<typename std::decay<Args>::type...>(sql, args...);
+			std::future<int64_t> future = w->promise.get_future();
+
+			_push(w);
+
+			return future;
+		}
+
+		/**
+		 * Stop the writer thread after the queued writes are committed,the writes queued after it throw.
+		 * It is called by the destructor.
+		 */
+		void stop()
+		{
+			if (!m_queue.stop())
+				return;
+
+			if (m_thread.joinable())
+				m_thread.join();
+
+			m_queue.drain([](write * w)
+			{
+				w->promise.set_exception(std::make_exception_ptr(std::runtime_error("the writer is stopped.")));
+				delete w;
+			});
+		}
+
+		group_commit_stats get_stats()
+		{
+			group_commit_stats stats;
+			stats.writes = m_writes.load(std::memory_order_relaxed);
+			stats.batches = m_batches.load(std::memory_order_relaxed);
+			stats.errors = m_errors.load(std::memory_order_relaxed);
+			stats.failed_batches = m_failed_batches.load(std::memory_order_relaxed);
+			return stats;
+		}
+
+	protected:
+		struct write
+		{
+			virtual ~write()
+			{
+			}
+
+			virtual int64_t run(connection & conn) = 0;
+
+			std::promise<int64_t> promise;
+		};
+
+		template<typename... Args>
+		struct write_impl : public write
+		{
+			template<typename... Values>
+			write_impl(const char * s, const Values&... values) : sql(s), args(values...)
+			{
+			}
+
+			virtual int64_t run(connection & conn) override
+			{
+				return args.exec(conn, sql.c_str());
+			}
+
+			std::string sql;
+			stored_args<Args...> args;
+		};
+
+		void _push(write * w)
+		{
+			if (!m_queue.push(w))
+			{
+				delete w;
+				throw std::runtime_error("the writer is stopped.");
+			}
+		}
+
+		void _run()
+		{
+			std::vector<write *> batch;
+			batch.reserve(m_max_batch);
+
+			write * w = nullptr;
+			for (;;)
+			{
+				if (!m_queue.try_pop(w))
+				{
+					if (m_queue.is_stopped())
+						break;
+
+					m_queue.wait_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+					continue;
+				}
+
+				batch.emplace_back(w);
+
+				// gather the writes of the other threads,don't wait when stopping
+				auto deadline = std::chrono::steady_clock::now() + m_window;
+				while (batch.size() < m_max_batch)
+				{
+					if (m_queue.try_pop(w))
+						batch.emplace_back(w);
+					else if (m_queue.is_stopped() || std::chrono::steady_clock::now() >= deadline)
+						break;
+					else
+						m_queue.wait_until(deadline);
+				}
+
+				_commit(batch);
+
+				for (auto p : batch)
+					delete p;
+				batch.clear();
+			}
+		}
+
+		static void _fail(std::vector<write *> & writes, std::exception_ptr e)
+		{
+			for (auto w : writes)
+				w->promise.set_exception(e);
+		}
+
+		/**
+		 * run the writes in one transaction,a failed write is removed and the others are run again.
+		 */
+		void _commit(std::vector<write *> & batch)
+		{
+			m_writes.fetch_add(batch.size(), std::memory_order_relaxed);
+
+			std::shared_ptr<connection> conn;
+			try
+			{
+				conn = m_acquire(std::chrono::milliseconds(m_timeout));
+				if (!conn)
+					throw std::runtime_error("no connection is available.");
+			}
+			catch (...)
+			{
+				m_failed_batches.fetch_add(1, std::memory_order_relaxed);
+				_fail(batch, std::current_exception());
+				return;
+			}
+
+			std::vector<write *> pending(batch);
+			std::vector<int64_t> results(pending.size());
+
+			while (!pending.empty())
+			{
+				// a single write needs no transaction
+				if (pending.size() == 1)
+				{
+					try
+					{
+						pending[0]->promise.set_value(pending[0]->run(*conn));
+						m_batches.fetch_add(1, std::memory_order_relaxed);
+					}
+					catch (...)
+					{
+						m_errors.fetch_add(1, std::memory_order_relaxed);
+						pending[0]->promise.set_exception(std::current_exception());
+					}
+					return;
+				}
+
+				if (!conn->begin_transaction())
+				{
+					m_failed_batches.fetch_add(1, std::memory_order_relaxed);
+					_fail(pending, std::make_exception_ptr(std::runtime_error(conn->get_last_error())));
+					return;
+				}
+
+				std::size_t i = 0;
+				std::exception_ptr error;
+				for (; i < pending.size(); i++)
+				{
+					try
+					{
+						results[i] = pending[i]->run(*conn);
+					}
+					catch (...)
+					{
+						error = std::current_exception();
+						break;
+					}
+				}
+
+				if (error)
+				{
+					conn->rollback();
+
+					m_errors.fetch_add(1, std::memory_order_relaxed);
+					pending[i]->promise.set_exception(error);
+					pending.erase(pending.begin() + i);
+					continue;
+				}
+
+				if (!conn->commit())
+				{
+					error = std::make_exception_ptr(std::runtime_error(conn->get_last_error()));
+
+					// the transaction is still open if the commit failed,end it before the connection is reused
+					conn->execute("ROLLBACK");
+
+					m_failed_batches.fetch_add(1, std::memory_order_relaxed);
+					_fail(pending, error);
+					return;
+				}
+
+				m_batches.fetch_add(1, std::memory_order_relaxed);
+				for (i = 0; i < pending.size(); i++)
+					pending[i]->promise.set_value(results[i]);
+				return;
+			}
+		}
+
+	private:
+		/// no copy construct function
+		group_commit(const group_commit&) = delete;
+
+		/// no operator equal function
+		group_commit& operator=(const group_commit&) = delete;
+
+	protected:
+
+		acquire_handler m_acquire;
+
+		std::chrono::milliseconds m_window;
+
+		std::size_t m_max_batch = zdb2::DEFAULT_GROUP_COMMIT_SIZE;
+
+		std::size_t m_timeout = zdb2::DEFAULT_TIMEOUT;
+
+		/// the writes,many callers push and the writer thread pops
+		writer_queue<write *> m_queue;
+
+		std::thread m_thread;
+
+		std::atomic<std::uint64_t> m_writes{ 0 };
+		std::atomic<std::uint64_t> m_batches{ 0 };
+		std::atomic<std::uint64_t> m_errors{ 0 };
+		std::atomic<std::uint64_t> m_failed_batches{ 0 };
+	};
+
+}
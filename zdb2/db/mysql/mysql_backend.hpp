@@ -0,0 +1,44 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ * 
+ */
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+
+#include <zdb2/config.hpp>
+#include <zdb2/net/url.hpp>
+
+#include <zdb2/db/mysql/mysql_connection.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the mysql backend for basic_pool,eg : zdb2::basic_pool<zdb2::mysql_backend>
+	 */
+	struct mysql_backend
+	{
+		typedef mysql_connection connection_type;
+		typedef mysql_resultset  resultset_type;
+		typedef mysql_stmt       stmt_type;
+
+		static bool is_supported(const std::string & dbtype)
+		{
+			return (dbtype == "mysql");
+		}
+
+		static connection_type * create(std::shared_ptr<url> url_ptr, std::size_t timeout)
+		{
+			return new mysql_connection(url_ptr, timeout);
+		}
+	};
+
+}
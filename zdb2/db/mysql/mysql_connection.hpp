@@ -11,6 +11,8 @@
 #pragma once
 
 #include <cctype>
+#include <cstdio>
+#include <cstdlib>
 #include <string>
 #include <memory>
 #include <algorithm>
@@ -24,6 +26,7 @@
 
 #include <zdb2/config.hpp>
 #include <zdb2/net/url.hpp>
+#include <zdb2/util/format_buffer.hpp>
 #include <zdb2/db/connection.hpp>
 
 #include <zdb2/db/mysql/mysql_util.hpp>
@@ -33,7 +36,7 @@
 namespace zdb2
 {
 
-	class mysql_connection : public connection
+	class mysql_connection final : public connection
 	{
 	public:
 		mysql_connection(
@@ -56,14 +59,18 @@ namespace zdb2
 		 * exceeded, then the <code>execute</code> methods will return
 		 * immediately with an error. The default timeout is <code>3
 		 * seconds</code>.
+		 * On MySQL the server bounds only the read only SELECT statements by
+		 * max_execution_time,the writes are not bounded,use cancel to stop them.
+		 * On MariaDB all the statements are bounded by max_statement_time.
 		 * @param C A Connection object
 		 * @param ms The query timeout limit in milliseconds; zero means
 		 * there is no limit
 		 */
-		void set_query_timeout(std::size_t ms)
+		virtual void set_query_timeout(std::size_t ms) override
 		{
 			connection::set_query_timeout(ms);
 
+			_set_execution_time();
 		}
 
 		//@}
@@ -101,6 +108,8 @@ namespace zdb2
 		 */
 		virtual void close() override
 		{
+			m_stmt_cache.clear();
+
 			if (m_db)
 			{
 				mysql_close(m_db);
@@ -109,6 +118,31 @@ namespace zdb2
 		}
 
 
+		/**
+		 * Cancel the SQL statement which is running on this Connection,it can
+		 * be called from another thread. A side connection is opened to send
+		 * KILL QUERY to the server,the statement fails with ER_QUERY_INTERRUPTED,
+		 * and the transaction is kept open.
+		 * @param C A Connection object
+		 */
+		virtual void cancel() override
+		{
+			if (!m_db)
+				return;
+
+			unsigned long thread_id = mysql_thread_id(m_db);
+
+			MYSQL * db = _open();
+			if (db)
+			{
+				char sql[64];
+				std::snprintf(sql, sizeof(sql), "KILL QUERY %lu", thread_id);
+				mysql_query(db, sql);
+				mysql_close(db);
+			}
+		}
+
+
 		/**
 		 * Start a transaction. 
 		 * @param C A Connection object
@@ -142,7 +176,12 @@ namespace zdb2
 				{
 					if (connection::commit())
 					{
-						return (mysql_util::MYSQL_OK == mysql_query(m_db, "COMMIT;"));
+						if (mysql_util::MYSQL_OK == mysql_query(m_db, "COMMIT;"))
+						{
+							_on_commit();
+							return true;
+						}
+						return false;
 					}
 				}
 			}
@@ -167,6 +206,7 @@ namespace zdb2
 				{
 					if (connection::rollback())
 					{
+						_on_rollback();
 						return (mysql_util::MYSQL_OK == mysql_query(m_db, "ROLLBACK;"));
 					}
 				}
@@ -218,20 +258,29 @@ namespace zdb2
 			if (!sql || sql[0] == '\0')
 				return false;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
-			
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
 
-			std::string str(len, '\0');
-
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
+
+			tracer * t = m_tracer.get();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
 			
-			return (mysql_util::MYSQL_OK == mysql_real_query(m_db, str.c_str(), (unsigned long)str.length()));
+			if (mysql_util::MYSQL_OK != mysql_real_query(m_db, str.c_str(), (unsigned long)str.length()))
+			{
+				if (t)
+					_trace_execute(*t, start, str.c_str(), true);
+				return false;
+			}
+
+			if (t)
+				_trace_execute(*t, start, str.c_str());
+
+			_on_write(str.c_str());
+			return true;
 		}
 
 		/**
@@ -258,41 +307,37 @@ namespace zdb2
 			if (!m_db || !sql || sql[0] == '\0')
 				return nullptr;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
 
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
-
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			std::shared_ptr<mysql_resultset> rs = _vquery(sql, ap);
 
 			va_end(ap);
 
-			MYSQL_STMT * stmt = mysql_stmt_init(m_db);
-			if (!stmt)
-				return nullptr;
+			return rs;
+		}
 
-			if (mysql_util::MYSQL_OK != mysql_stmt_prepare(stmt, str.c_str(), (unsigned long)str.length()))
-			{
-				mysql_stmt_close(stmt);
+		/**
+		 * The same as query,but returns the mysql resultset directly,so the calls on the 
+		 * resultset are not virtual and can be inlined into the caller's row loop.
+		 * @param C A Connection object
+		 * @param sql A SQL statement
+		 * @return A mysql_resultset object that contains the data produced by the
+		 * given query. 
+		 */
+		std::shared_ptr<mysql_resultset> execute_query(const char *sql, ...)
+		{
+			if (!m_db || !sql || sql[0] == '\0')
 				return nullptr;
-			}
 
-#if MYSQL_VERSION_ID >= 50002
-			unsigned long cursor = CURSOR_TYPE_READ_ONLY;
-			mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
-#endif
+			va_list ap;
+			va_start(ap, sql);
 
-			if ((mysql_util::MYSQL_OK != mysql_stmt_execute(stmt)))
-			{
-				mysql_stmt_close(stmt);
-				return nullptr;
-			}
+			std::shared_ptr<mysql_resultset> rs = _vquery(sql, ap);
+
+			va_end(ap);
 
-			return std::dynamic_pointer_cast<resultset>(std::make_shared<mysql_resultset>(stmt, m_timeout));
+			return rs;
 		}
 
 		/**
@@ -319,20 +364,15 @@ namespace zdb2
 			if (!sql || sql[0] == '\0')
 				return nullptr;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
 
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
-
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
 
-			return std::dynamic_pointer_cast<stmt>(std::make_shared<mysql_stmt>(m_db,str.c_str(),m_timeout));
+			return _prepare_cached(str.c_str());
 		}
 
 
@@ -371,12 +411,153 @@ namespace zdb2
 		// @}
 
 	protected:
+		/**
+		 * the cached statement skips the parse and plan,and for the server databases a round trip.
+		 */
+		virtual std::shared_ptr<stmt> _prepare_cached(const char * sql) override
+		{
+			std::shared_ptr<stmt> s = m_stmt_cache.get(sql);
+			if (s)
+			{
+				s->reset();
+				return s;
+			}
+
+			s = _prepare_new(sql);
+			if (s->is_prepared())
+				m_stmt_cache.put(sql, s);
+
+			return s;
+		}
+
+		virtual std::shared_ptr<stmt> _prepare_new(const char * sql) override
+		{
+			tracer * t = m_tracer.get();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			std::shared_ptr<stmt> s = std::make_shared<mysql_stmt>(m_db, sql, m_timeout);
+			if (s->is_prepared())
+			{
+				if (t)
+					_trace_prepare(*s, start);
+				_listen(*s);
+			}
+			else if (t)
+				_trace_execute(*t, start, sql, true);
+
+			return s;
+		}
+
+		/**
+		 * a multi-row INSERT statement is limited by the placeholders count and the max_allowed_packet,
+		 * the half of the packet is used,so the length prefixes and the sql text never overflow it.
+		 */
+		virtual void _batch_limits(std::size_t columns, std::size_t & max_rows, std::size_t & max_bytes) override
+		{
+			max_rows = std::min<std::size_t>(zdb2::DEFAULT_BATCH_ROWS, mysql_util::MAX_PLACEHOLDERS / columns);
+
+			if (m_max_allowed_packet == 0)
+				m_max_allowed_packet = _get_max_allowed_packet();
+
+			max_bytes = m_max_allowed_packet / 2;
+		}
+
+		std::size_t _get_max_allowed_packet()
+		{
+			std::size_t size = 0;
+
+			if (mysql_util::MYSQL_OK == mysql_query(m_db, "select @@max_allowed_packet"))
+			{
+				MYSQL_RES * res = mysql_store_result(m_db);
+				if (res)
+				{
+					MYSQL_ROW row = mysql_fetch_row(res);
+					if (row && row[0])
+						size = (std::size_t)std::strtoull(row[0], nullptr, 10);
+					mysql_free_result(res);
+				}
+			}
+
+			return (size > 0 ? size : mysql_util::DEFAULT_MAX_ALLOWED_PACKET);
+		}
+
 		virtual bool _init() override
 		{
 			return _connect();
 		}
 
 		virtual bool _connect() override
+		{
+			m_db = _open();
+			if (!m_db)
+				return false;
+
+			// the server may be another one,so probe the variable again
+			m_execution_time_variable = execution_time_variable::unknown;
+
+			_set_execution_time();
+			return true;
+		}
+
+		/**
+		 * the statements running longer than the query timeout are aborted by the server,the read only
+		 * SELECT statements by the max_execution_time of MySQL 5.7.8,all the statements by the
+		 * max_statement_time of MariaDB 10.1,the writes on MySQL are not bounded.The variable is probed
+		 * once by the first call after the connection is opened,and the timeout is sent to the server
+		 * only when it is changed or the session is a new one after a automatic reconnection,so the
+		 * release which restores the same timeout costs no round trip.
+		 */
+		void _set_execution_time()
+		{
+			if (!m_db)
+				return;
+
+			// the thread id of the session is changed by a automatic reconnection,which resets the variables
+			unsigned long thread_id = mysql_thread_id(m_db);
+			if (m_execution_time_variable != execution_time_variable::unknown &&
+				m_server_timeout == m_timeout && m_server_thread_id == thread_id)
+				return;
+
+			char sql[64];
+
+			if (m_execution_time_variable == execution_time_variable::unknown ||
+				m_execution_time_variable == execution_time_variable::max_execution_time)
+			{
+				std::snprintf(sql, sizeof(sql), "SET SESSION max_execution_time=%lu", (unsigned long)m_timeout);
+				if (mysql_util::MYSQL_OK == mysql_query(m_db, sql))
+				{
+					m_execution_time_variable = execution_time_variable::max_execution_time;
+					m_server_timeout = m_timeout;
+					m_server_thread_id = thread_id;
+					return;
+				}
+				if (m_execution_time_variable != execution_time_variable::unknown)
+					return;
+			}
+
+			if (m_execution_time_variable == execution_time_variable::unknown ||
+				m_execution_time_variable == execution_time_variable::max_statement_time)
+			{
+				std::snprintf(sql, sizeof(sql), "SET SESSION max_statement_time=%.3f", (double)m_timeout / 1000.0);
+				if (mysql_util::MYSQL_OK == mysql_query(m_db, sql))
+				{
+					m_execution_time_variable = execution_time_variable::max_statement_time;
+					m_server_timeout = m_timeout;
+					m_server_thread_id = thread_id;
+					return;
+				}
+				if (m_execution_time_variable != execution_time_variable::unknown)
+					return;
+			}
+
+			// a old server which has none of them
+			m_execution_time_variable = execution_time_variable::none;
+		}
+
+		/**
+		 * open a new mysql handler by the url,used by the connection and by cancel.
+		 */
+		MYSQL * _open()
 		{
 			unsigned long client_flags = CLIENT_MULTI_STATEMENTS;
 			int connect_timeout = zdb2::DEFAULT_TCP_TIMEOUT;
@@ -397,34 +578,34 @@ namespace zdb2
 			else if (host.empty())
 			{
 				throw std::runtime_error("no host specified in url.");
-				return false;
+				return nullptr;
 			}
 			if (port.empty())
 			{
 				throw std::runtime_error("no port specified in url.");
-				return false;
+				return nullptr;
 			}
 			if (database.empty())
 			{
 				throw std::runtime_error("no database specified in url.");
-				return false;
+				return nullptr;
 			}
 			if (user.empty())
 			{
 				throw std::runtime_error("no username specified in url.");
-				return false;
+				return nullptr;
 			}
 			if (pass.empty())
 			{
 				throw std::runtime_error("no password specified in url.");
-				return false;
+				return nullptr;
 			}
 
-			m_db = mysql_init(nullptr);
-			if (!m_db)
+			MYSQL * db = mysql_init(nullptr);
+			if (!db)
 			{
 				throw std::runtime_error("unable to allocate mysql handler.");
-				return false;
+				return nullptr;
 			}
 			
 			/* Options */
@@ -432,12 +613,12 @@ namespace zdb2
 				client_flags |= CLIENT_COMPRESS;
 
 			if (m_url_ptr->get_param_value("use-ssl") == "true")
-				mysql_ssl_set(m_db, nullptr, nullptr, nullptr, nullptr, nullptr);
+				mysql_ssl_set(db, nullptr, nullptr, nullptr, nullptr, nullptr);
 
 			if (m_url_ptr->get_param_value("secure-auth") == "true")
-				mysql_options(m_db, MYSQL_SECURE_AUTH, (const void*)&mysql_util::yes);
+				mysql_options(db, MYSQL_SECURE_AUTH, (const void*)&mysql_util::yes);
 			else
-				mysql_options(m_db, MYSQL_SECURE_AUTH, (const void*)&mysql_util::no);
+				mysql_options(db, MYSQL_SECURE_AUTH, (const void*)&mysql_util::no);
 
 			if (!timeout.empty())
 			{
@@ -445,26 +626,96 @@ namespace zdb2
 				if (_timeout > 0)
 					connect_timeout = _timeout;
 			}
-			mysql_options(m_db, MYSQL_OPT_CONNECT_TIMEOUT, (const void *)&connect_timeout);
+			mysql_options(db, MYSQL_OPT_CONNECT_TIMEOUT, (const void *)&connect_timeout);
 
 			if (!charset.empty())
-				mysql_options(m_db, MYSQL_SET_CHARSET_NAME, (const void *)charset.c_str());
+				mysql_options(db, MYSQL_SET_CHARSET_NAME, (const void *)charset.c_str());
 
 #if MYSQL_VERSION_ID >= 50013
-			mysql_options(m_db, MYSQL_OPT_RECONNECT, (const void*)&mysql_util::yes);
+			mysql_options(db, MYSQL_OPT_RECONNECT, (const void*)&mysql_util::yes);
 #endif
 			/* Connect */
-			if (mysql_real_connect(m_db, host.c_str(), user.c_str(), pass.c_str(), database.c_str(), (unsigned int)std::atoi(port.c_str()), unix_socket.c_str(), client_flags))
-				return true;
+			if (mysql_real_connect(db, host.c_str(), user.c_str(), pass.c_str(), database.c_str(), (unsigned int)std::atoi(port.c_str()), unix_socket.c_str(), client_flags))
+				return db;
 
-			mysql_close(m_db);
+			mysql_close(db);
 
-			return false;
+			return nullptr;
 		}
 
+		std::shared_ptr<mysql_resultset> _vquery(const char *sql, va_list ap)
+		{
+			format_buffer str;
+			str.vformat(sql, ap);
+
+			tracer * t = m_tracer.get();
+			auto prepare_start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			MYSQL_STMT * stmt = mysql_stmt_init(m_db);
+			if (!stmt)
+				return nullptr;
+
+			if (mysql_util::MYSQL_OK != mysql_stmt_prepare(stmt, str.c_str(), (unsigned long)str.length()))
+			{
+				if (t)
+					_trace_execute(*t, prepare_start, str.c_str(), true);
+				mysql_stmt_close(stmt);
+				return nullptr;
+			}
+
+#if MYSQL_VERSION_ID >= 50002
+			unsigned long cursor = CURSOR_TYPE_READ_ONLY;
+			mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
+#endif
+
+			auto execute_start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			if ((mysql_util::MYSQL_OK != mysql_stmt_execute(stmt)))
+			{
+				if (t)
+					_trace_execute(*t, prepare_start, str.c_str(), true);
+				mysql_stmt_close(stmt);
+				return nullptr;
+			}
+
+			std::shared_ptr<mysql_resultset> rs = std::make_shared<mysql_resultset>(stmt, m_timeout);
+
+			if (t)
+				_trace_query(*t, prepare_start, execute_start, str.c_str(), *rs);
+
+			return rs;
+		}
+
+	protected:
+		/// the session variable which bounds the execution time of the statements on the server
+		enum class execution_time_variable
+		{
+			/// not probed yet
+			unknown,
+
+			/// MySQL 5.7.8
+			max_execution_time,
+
+			/// MariaDB 10.1
+			max_statement_time,
+
+			/// the server has no such variable
+			none,
+		};
+
 	protected:
 
 		MYSQL * m_db = nullptr;
+
+		/// the max_allowed_packet of the server,read by the first insert_many
+		std::size_t m_max_allowed_packet = 0;
+
+		/// probed by the first _set_execution_time after the connection is opened
+		execution_time_variable m_execution_time_variable = execution_time_variable::unknown;
+
+		/// the query timeout which is set on the server,and the session it is set on,see _set_execution_time
+		std::size_t m_server_timeout = 0;
+		unsigned long m_server_thread_id = 0;
 	};
 
 }
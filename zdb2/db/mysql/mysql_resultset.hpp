@@ -18,11 +18,15 @@
 #include <mutex>
 #include <unordered_map>
 #include <ctime>
+#include <cstdio>
+#include <vector>
+#include <new>
 
 #include <mysql.h>
 #include <errmsg.h>
 
 #include <zdb2/db/resultset.hpp>
+#include <zdb2/db/stmt.hpp>
 #include <zdb2/db/mysql/mysql_util.hpp>
 
 namespace zdb2
@@ -30,7 +34,7 @@ namespace zdb2
 
 #pragma warning(disable:4996)
 
-	class mysql_resultset : public resultset
+	class mysql_resultset final : public resultset
 	{
 	public:
 		mysql_resultset(
@@ -47,6 +51,26 @@ namespace zdb2
 			_init();
 		}
 
+		/**
+		 * the resultset of a prepared statement,the statement is not closed with the resultset,
+		 * the owner keeps the statement alive while the resultset is used.
+		 */
+		mysql_resultset(
+			MYSQL_STMT * stmt,
+			std::size_t timeout,
+			std::shared_ptr<zdb2::stmt> owner
+		)
+			: resultset(timeout)
+			, m_stmt(stmt)
+			, m_owner(owner)
+		{
+			assert(m_stmt);
+			if (!m_stmt)
+				throw std::runtime_error("invalid parameters.");
+
+			_init();
+		}
+
 		virtual ~mysql_resultset()
 		{
 			close();
@@ -54,11 +78,17 @@ namespace zdb2
 
 		virtual void close() override
 		{
+			_trace_finish();
+
 			if (m_stmt)
 			{
 				mysql_stmt_free_result(m_stmt);
-				mysql_stmt_close(m_stmt);
+				if (m_owner)
+					mysql_stmt_reset(m_stmt);
+				else
+					mysql_stmt_close(m_stmt);
 				m_stmt = nullptr;
+				m_owner.reset();
 			}
 			if (m_meta)
 			{
@@ -108,14 +138,37 @@ namespace zdb2
 		}
 
 		/**
-		 * @function : get column index by column name
+		 * Returns the type the values of the designated column are best read as,
+		 * by the field type of the column.
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @return The column type
 		 */
-		virtual int get_column_index(const char * column_name) override
+		virtual column_type get_column_type(int column_index) override
 		{
-			auto iterator = m_column_name_map.find(column_name);
-			if (iterator != m_column_name_map.end())
-				return iterator->second;
-			return -1;
+			if (m_column_count <= 0 || column_index < 0 || column_index >= m_column_count)
+				return column_type::text;
+
+			switch (m_columns[column_index].field->type)
+			{
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_YEAR:
+				return column_type::int64;
+			case MYSQL_TYPE_FLOAT:
+			case MYSQL_TYPE_DOUBLE:
+				return column_type::real;
+			case MYSQL_TYPE_TINY_BLOB:
+			case MYSQL_TYPE_MEDIUM_BLOB:
+			case MYSQL_TYPE_LONG_BLOB:
+			case MYSQL_TYPE_BLOB:
+				return column_type::blob;
+			default:
+				return column_type::text;
+			}
 		}
 
 		/**
@@ -136,6 +189,8 @@ namespace zdb2
 				return 0;
 			if (m_columns[column_index].is_null)
 				return 0;
+			if (m_columns[column_index].is_time)
+				return _time_text(column_index);
 			return m_columns[column_index].length;
 		}
 
@@ -165,11 +220,122 @@ namespace zdb2
 				m_need_rebind = false;
 			}
 
+			auto start = (m_tracer ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
 			int status = mysql_stmt_fetch(m_stmt);
 			if (1 == status)
+			{
+				if (m_tracer)
+					_trace_error(start);
 				throw std::runtime_error(mysql_stmt_error(m_stmt));
+			}
+
+			bool found = ((status == mysql_util::MYSQL_OK) || (status == MYSQL_DATA_TRUNCATED));
 
-			return ((status == mysql_util::MYSQL_OK) || (status == MYSQL_DATA_TRUNCATED));
+			if (m_tracer)
+			{
+				if (found)
+					_trace_fetch(start, 1, _row_bytes());
+				else
+				{
+					_trace_fetch(start, 0, 0);
+					_trace_finish();
+				}
+			}
+			return found;
+		}
+
+
+		/**
+		 * Moves the cursor down up to <code>n</code> rows and appends the values
+		 * of every row to the column buffers,see resultset::fetch_batch. The int64
+		 * and real columns are bound to the native types while fetching,so the
+		 * client library converts them without the text.
+		 * @param R A ResultSet object
+		 * @param n The maximum number of rows to fetch
+		 * @param columns The column buffers
+		 * @return The number of rows fetched,0 if there are no more rows
+		 * @exception SQLException If a database access error occurs
+		 */
+		virtual std::size_t fetch_batch(std::size_t n, std::vector<column_buffer> & columns) override
+		{
+			for (auto & column : columns)
+				column.clear();
+
+			if (!m_stmt || !m_meta || m_column_count <= 0)
+				return 0;
+
+			int count = std::min((int)columns.size(), m_column_count);
+
+			_bind_batch(columns, count);
+
+			auto start = (m_tracer ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+			std::size_t bytes = 0;
+			bool done = false;
+
+			std::size_t rows = 0;
+			while (rows < n)
+			{
+				int status = mysql_stmt_fetch(m_stmt);
+				if (1 == status)
+				{
+					if (m_tracer)
+						_trace_error(start);
+					throw std::runtime_error(mysql_stmt_error(m_stmt));
+				}
+				if (status != mysql_util::MYSQL_OK && status != MYSQL_DATA_TRUNCATED)
+				{
+					done = true;
+					break;
+				}
+
+				if (m_tracer)
+					bytes += _row_bytes();
+
+				for (int i = 0; i < count; i++)
+				{
+					column_buffer & column = columns[i];
+
+					if (m_columns[i].is_null)
+					{
+						column.push_null();
+						continue;
+					}
+
+					switch (column.get_type())
+					{
+					case column_type::int64:
+						column.push_int64(m_batch_values[i].type.llong);
+						break;
+					case column_type::real:
+						column.push_double(m_batch_values[i].type.real);
+						break;
+					case column_type::text:
+					case column_type::blob:
+						if (!m_columns[i].is_time && m_columns[i].length > m_bind[i].buffer_length)
+						{
+							_ensure_capacity(i);
+
+							// the buffer is moved,bind it again for the next row
+							m_batch_bind[i].buffer = m_bind[i].buffer;
+							m_batch_bind[i].buffer_length = m_bind[i].buffer_length;
+							if ((mysql_util::MYSQL_OK != mysql_stmt_bind_result(m_stmt, m_batch_bind.data())))
+								throw std::runtime_error(mysql_stmt_error(m_stmt));
+						}
+						column.push_bytes(m_columns[i].buffer, m_columns[i].length);
+						break;
+					}
+				}
+				rows++;
+			}
+
+			if (m_tracer)
+			{
+				_trace_fetch(start, rows, bytes);
+				if (done)
+					_trace_finish();
+			}
+			return rows;
 		}
 
 		/** @name Columns */
@@ -220,6 +386,12 @@ namespace zdb2
 				if (m_columns[column_index].is_null)
 					return nullptr;
 
+				if (m_columns[column_index].is_time)
+				{
+					_time_text(column_index);
+					return m_columns[column_index].buffer;
+				}
+
 				_ensure_capacity(column_index);
 
 				m_columns[column_index].buffer[m_columns[column_index].length] = 0;
@@ -408,14 +580,26 @@ namespace zdb2
 		 */
 		virtual const void * get_blob(int column_index, std::size_t * size) override
 		{
+			if (size)
+				*size = 0;
+
 			if (m_stmt && m_bind && m_columns && column_index >= 0 && column_index < m_column_count)
 			{
 				if (m_columns[column_index].is_null)
 					return nullptr;
 
+				if (m_columns[column_index].is_time)
+				{
+					std::size_t length = _time_text(column_index);
+					if (size)
+						*size = length;
+					return (const void *)m_columns[column_index].buffer;
+				}
+
 				_ensure_capacity(column_index);
 
-				*size = m_columns[column_index].length;
+				if (size)
+					*size = m_columns[column_index].length;
 
 				return (const void *)m_columns[column_index].buffer;
 			}
@@ -441,9 +625,31 @@ namespace zdb2
 		virtual const void * get_blob(const char * column_name, std::size_t * size) override
 		{
 			int col_index = get_column_index(column_name);
+			if (col_index < 0 && size)
+				*size = 0;
 			return ((col_index >= 0) ? get_blob(col_index, size) : nullptr);
 		}
 
+
+		/**
+		 * Retrieves the value of the designated column in the current row of
+		 * this ResultSet object as a pointer to the text and its length,see 
+		 * resultset::get_text. The text is the bind buffer of the column and 
+		 * <i>it is not NUL terminated</i>,it is valid until the next call to 
+		 * next_row() or close().
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @param size The number of bytes in the text is stored in size 
+		 * @return The column value; if the value is SQL NULL, the value
+		 * returned is NULL and the size is 0
+		 */
+		virtual const char * get_text(int column_index, std::size_t * size) override
+		{
+			return (const char *)get_blob(column_index, size);
+		}
+
+		using resultset::get_text;
+
 		//@}
 
 		/** @name Date and Time  */
@@ -477,8 +683,16 @@ namespace zdb2
 		 */
 		virtual time_t get_timestamp(int column_index) override
 		{
-			// Not integer storage class, try to parse as time string
-			return (time_t)0;
+			if (!m_stmt || !m_columns || column_index < 0 || column_index >= m_column_count || m_columns[column_index].is_null)
+				return (time_t)0;
+
+			if (m_columns[column_index].is_time)
+				return datetime_parser::to_timestamp(_time_value(column_index));
+
+			// the temporal values in the other columns,eg : a VARCHAR or a expression,are parsed from the text
+			std::size_t size = 0;
+			const char * s = get_text(column_index, &size);
+			return datetime_parser::to_timestamp(_parse_datetime(s, size));
 		}
 
 
@@ -546,22 +760,16 @@ namespace zdb2
 		virtual tm get_datetime(int column_index) override
 		{
 			struct tm tm = { 0 };
-			if (!m_stmt)
+			if (!m_stmt || !m_columns || column_index < 0 || column_index >= m_column_count || m_columns[column_index].is_null)
 				return tm;
-			//if (sqlite3_column_type(m_stmt, column_index) == SQLITE_INTEGER)
-			//{
-			//	time_t utc = (time_t)sqlite3_column_int64(m_stmt, column_index);
-			//	struct tm * utc_tm = std::gmtime(&utc);
-			//	if (utc_tm)
-			//		utc_tm->tm_year += 1900; // Use year literal
-			//	return (*utc_tm);
-			//}
-			//else
-			//{
-			//	// Not integer storage class, try to parse as time string
 
-			//}
-			return tm;
+			// a negative TIME has the negative tm_hour,tm_min and tm_sec,like the timestamp of it
+			if (m_columns[column_index].is_time)
+				return datetime_parser::to_tm(_time_value(column_index));
+
+			std::size_t size = 0;
+			const char * s = get_text(column_index, &size);
+			return datetime_parser::to_tm(_parse_datetime(s, size));
 		}
 
 
@@ -606,7 +814,10 @@ namespace zdb2
 			if ((m_columns[i].length > m_bind[i].buffer_length))
 			{
 				/* Column was truncated, resize and fetch column directly. */
-				std::realloc(m_columns[i].buffer, m_columns[i].length + 1);
+				char * buffer = (char *)std::realloc(m_columns[i].buffer, m_columns[i].length + 1);
+				if (!buffer)
+					throw std::bad_alloc();
+				m_columns[i].buffer = buffer;
 
 				m_bind[i].buffer = m_columns[i].buffer;
 				m_bind[i].buffer_length = m_columns[i].length;
@@ -618,6 +829,122 @@ namespace zdb2
 			}
 		}
 
+		/// the fields of a temporal column,the fields of a negative TIME are negative
+		datetime_value _time_value(int i)
+		{
+			const MYSQL_TIME & t = m_columns[i].time;
+
+			datetime_value v;
+			v.has_date = (t.time_type != MYSQL_TIMESTAMP_TIME);
+			v.has_time = (t.time_type != MYSQL_TIMESTAMP_DATE);
+			if (v.has_date)
+			{
+				v.year = (int)t.year;
+				v.month = (int)t.month;
+				v.day = (int)t.day;
+			}
+			v.hour = (int)t.hour;
+			v.minute = (int)t.minute;
+			v.second = (int)t.second;
+			v.microsecond = (int)t.second_part;
+			if (t.neg)
+			{
+				v.hour = -v.hour;
+				v.minute = -v.minute;
+				v.second = -v.second;
+				v.microsecond = -v.microsecond;
+			}
+			return v;
+		}
+
+		/**
+		 * format a temporal column to the text of the MySQL text protocol,eg : "2017-01-02 03:04:05.123",
+		 * the fraction has the digits of the column decimals.
+		 * @return The length of the text
+		 */
+		std::size_t _time_text(int i)
+		{
+			const MYSQL_TIME & t = m_columns[i].time;
+			char * p = m_columns[i].buffer;
+			int n = 0;
+
+			switch (t.time_type)
+			{
+			case MYSQL_TIMESTAMP_DATE:
+				n = std::snprintf(p, mysql_util::STRLEN, "%04u-%02u-%02u", t.year, t.month, t.day);
+				break;
+			case MYSQL_TIMESTAMP_TIME:
+				n = std::snprintf(p, mysql_util::STRLEN, "%s%02u:%02u:%02u", (t.neg ? "-" : ""), t.hour, t.minute, t.second);
+				break;
+			default:
+				n = std::snprintf(p, mysql_util::STRLEN, "%04u-%02u-%02u %02u:%02u:%02u",
+					t.year, t.month, t.day, t.hour, t.minute, t.second);
+				break;
+			}
+
+			unsigned int decimals = m_columns[i].field->decimals;
+			if (t.time_type != MYSQL_TIMESTAMP_DATE && decimals > 0 && decimals <= 6 && n > 0)
+			{
+				static const unsigned long scale[] = { 1, 100000, 10000, 1000, 100, 10, 1 };
+				n += std::snprintf(p + n, mysql_util::STRLEN - n, ".%0*lu", (int)decimals, t.second_part / scale[decimals]);
+			}
+
+			return (n > 0 ? (std::size_t)n : 0);
+		}
+
+		/// the bytes of the values of the current row
+		std::size_t _row_bytes()
+		{
+			std::size_t bytes = 0;
+			for (int i = 0; i < m_column_count; i++)
+			{
+				if (!m_columns[i].is_null)
+					bytes += m_columns[i].length;
+			}
+			return bytes;
+		}
+
+		/**
+		 * bind the int64 and real columns to the native types,the others to the text buffers of next_row.
+		 */
+		void _bind_batch(std::vector<column_buffer> & columns, int count)
+		{
+			m_batch_bind.assign(m_bind, m_bind + m_column_count);
+			m_batch_values.resize(m_column_count);
+
+			for (int i = 0; i < count; i++)
+			{
+				switch (columns[i].get_type())
+				{
+				case column_type::int64:
+					m_batch_bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+					m_batch_bind[i].buffer = &m_batch_values[i].type.llong;
+					m_batch_bind[i].buffer_length = sizeof(m_batch_values[i].type.llong);
+					break;
+				case column_type::real:
+					m_batch_bind[i].buffer_type = MYSQL_TYPE_DOUBLE;
+					m_batch_bind[i].buffer = &m_batch_values[i].type.real;
+					m_batch_bind[i].buffer_length = sizeof(m_batch_values[i].type.real);
+					break;
+				default:
+					// the text of the temporal columns
+					if (m_columns[i].is_time)
+					{
+						m_batch_bind[i].buffer_type = MYSQL_TYPE_STRING;
+						m_batch_bind[i].buffer = m_columns[i].buffer;
+						m_batch_bind[i].buffer_length = mysql_util::STRLEN;
+					}
+					break;
+				}
+			}
+
+			if ((mysql_util::MYSQL_OK != mysql_stmt_bind_result(m_stmt, m_batch_bind.data())))
+				throw std::runtime_error(mysql_stmt_error(m_stmt));
+
+			// next_row binds the text buffers again
+			m_need_rebind = true;
+		}
+
 		virtual void _init() override
 		{
 			if (m_stmt)
@@ -649,18 +976,23 @@ namespace zdb2
 						m_bind[i].length = &m_columns[i].length;
 
 						m_columns[i].field = mysql_fetch_field_direct(m_meta, i);
+
+						// the temporal columns are fetched as MYSQL_TIME,so get_timestamp and get_datetime
+						// don't parse the text,and the text is only formatted by get_string
+						enum_field_types time_type = mysql_util::temporal_type(m_columns[i].field->type);
+						if (time_type != MYSQL_TYPE_NULL)
+						{
+							m_columns[i].is_time = true;
+							m_bind[i].buffer_type = time_type;
+							m_bind[i].buffer = &m_columns[i].time;
+							m_bind[i].buffer_length = sizeof(MYSQL_TIME);
+						}
 					}
 
 					if ((mysql_util::MYSQL_OK != mysql_stmt_bind_result(m_stmt, m_bind)))
 					{
 						throw std::runtime_error(mysql_stmt_error(m_stmt));
 					}
-
-					for (int col = 0; col < m_column_count; col++)
-					{
-						std::string col_name(get_column_name(col));
-						m_column_name_map.emplace(col_name, col);
-					}
 				}
 
 			}
@@ -670,9 +1002,10 @@ namespace zdb2
 
 		MYSQL_STMT * m_stmt = nullptr;
 
-		MYSQL_RES * m_meta = nullptr;
+		/// the prepared statement which owns the m_stmt,empty if the m_stmt is owned by this resultset
+		std::shared_ptr<zdb2::stmt> m_owner;
 
-		std::unordered_map<std::string, int> m_column_name_map;
+		MYSQL_RES * m_meta = nullptr;
 
 		MYSQL_BIND * m_bind = nullptr;
 
@@ -682,6 +1015,11 @@ namespace zdb2
 
 		bool m_need_rebind = false;
 
+		/// the result binds and the numeric values of fetch_batch
+		std::vector<MYSQL_BIND> m_batch_bind;
+
+		std::vector<mysql_util::param_t> m_batch_values;
+
 	};
 
 }
@@ -15,17 +15,22 @@
 #include <memory>
 #include <algorithm>
 #include <mutex>
+#include <cstdio>
+#include <cstring>
 
 #include <mysql.h>
 #include <errmsg.h>
 
+#include <zdb2/util/sql_scanner.hpp>
+#include <zdb2/util/datetime_parser.hpp>
 #include <zdb2/db/stmt.hpp>
 #include <zdb2/db/mysql/mysql_util.hpp>
+#include <zdb2/db/mysql/mysql_resultset.hpp>
 
 namespace zdb2
 {
 
-	class mysql_stmt : public stmt
+	class mysql_stmt final : public stmt
 	{
 	public:
 		mysql_stmt(
@@ -66,6 +71,32 @@ namespace zdb2
 			}
 		}
 
+		/**
+		 * Reset the statement to its initial state and clear all the parameters.
+		 * @param P A PreparedStatement object
+		 */
+		virtual void reset() override
+		{
+			if (m_stmt)
+				mysql_stmt_reset(m_stmt);
+
+			if (m_bind && m_params)
+			{
+				std::memset(m_params, 0, sizeof(mysql_util::param_t) * m_param_count);
+				std::memset(m_bind, 0, sizeof(MYSQL_BIND) * m_param_count);
+
+				for (int i = 0; i < m_param_count; i++)
+				{
+					m_bind[i].buffer_type = MYSQL_TYPE_NULL;
+				}
+			}
+		}
+
+		virtual bool is_prepared() override
+		{
+			return (m_stmt != nullptr);
+		}
+
 		/** @name Parameters */
 		//@{
 
@@ -82,23 +113,24 @@ namespace zdb2
 		*/
 		virtual void set_string(int param_index, const char * x) override
 		{
-			if (m_stmt && m_bind && m_params && param_index >= 0)
+			int i = _param_index(param_index);
+			if (m_stmt && m_bind && m_params)
 			{
-				m_bind[param_index].buffer_type = MYSQL_TYPE_STRING;
-				m_bind[param_index].buffer = (char*)x;
+				m_bind[i].buffer_type = MYSQL_TYPE_STRING;
+				m_bind[i].buffer = (char*)x;
 
 				if (!x)
 				{
-					m_params[param_index].length = 0;
-					m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::yes);
+					m_params[i].length = 0;
+					m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::yes);
 				}
 				else
 				{
-					m_params[param_index].length = (unsigned long)std::strlen(x);
-					m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::no);
+					m_params[i].length = (unsigned long)std::strlen(x);
+					m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::no);
 				}
 
-				m_bind[param_index].length = &m_params[param_index].length;
+				m_bind[i].length = &m_params[i].length;
 			}
 		}
 
@@ -121,12 +153,13 @@ namespace zdb2
 		 */
 		virtual void set_int(int param_index, int x) override
 		{
-			if (m_stmt && m_bind && m_params && param_index >= 0)
+			int i = _param_index(param_index);
+			if (m_stmt && m_bind && m_params)
 			{
-				m_params[param_index].type.integer = x;
-				m_bind[param_index].buffer_type = MYSQL_TYPE_LONG;
-				m_bind[param_index].buffer = &m_params[param_index].type.integer;
-				m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::no);
+				m_params[i].type.integer = x;
+				m_bind[i].buffer_type = MYSQL_TYPE_LONG;
+				m_bind[i].buffer = &m_params[i].type.integer;
+				m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::no);
 			}
 		}
 
@@ -149,12 +182,13 @@ namespace zdb2
 		 */
 		virtual void set_int64(int param_index, int64_t x) override
 		{
-			if (m_stmt && m_bind && m_params && param_index >= 0)
+			int i = _param_index(param_index);
+			if (m_stmt && m_bind && m_params)
 			{
-				m_params[param_index].type.llong = x;
-				m_bind[param_index].buffer_type = MYSQL_TYPE_LONGLONG;
-				m_bind[param_index].buffer = &m_params[param_index].type.llong;
-				m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::no);
+				m_params[i].type.llong = x;
+				m_bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+				m_bind[i].buffer = &m_params[i].type.llong;
+				m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::no);
 			}
 		}
 
@@ -171,12 +205,13 @@ namespace zdb2
 		 */
 		virtual void set_double(int param_index, double x) override
 		{
-			if (m_stmt && m_bind && m_params && param_index >= 0)
+			int i = _param_index(param_index);
+			if (m_stmt && m_bind && m_params)
 			{
-				m_params[param_index].type.real = x;
-				m_bind[param_index].buffer_type = MYSQL_TYPE_DOUBLE;
-				m_bind[param_index].buffer = &m_params[param_index].type.real;
-				m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::no);
+				m_params[i].type.real = x;
+				m_bind[i].buffer_type = MYSQL_TYPE_DOUBLE;
+				m_bind[i].buffer = &m_params[i].type.real;
+				m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::no);
 			}
 		}
 
@@ -194,23 +229,24 @@ namespace zdb2
 		 */
 		virtual void set_blob(int param_index, const void * x, std::size_t size) override
 		{
-			if (m_stmt && m_bind && m_params && param_index >= 0)
+			int i = _param_index(param_index);
+			if (m_stmt && m_bind && m_params)
 			{
-				m_bind[param_index].buffer_type = MYSQL_TYPE_BLOB;
-				m_bind[param_index].buffer = (void*)x;
+				m_bind[i].buffer_type = MYSQL_TYPE_BLOB;
+				m_bind[i].buffer = (void*)x;
 
 				if (!x)
 				{
-					m_params[param_index].length = 0;
-					m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::yes);
+					m_params[i].length = 0;
+					m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::yes);
 				}
 				else
 				{
-					m_params[param_index].length = (unsigned long)size;
-					m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::no);
+					m_params[i].length = (unsigned long)size;
+					m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::no);
 				}
 
-				m_bind[param_index].length = &m_params[param_index].length;
+				m_bind[i].length = &m_params[i].length;
 			}
 		}
 
@@ -233,21 +269,25 @@ namespace zdb2
 		 */
 		virtual void set_timestamp(int param_index, time_t x) override
 		{
-			if (m_stmt && m_bind && m_params && param_index >= 0)
+			int i = _param_index(param_index);
+			if (m_stmt && m_bind && m_params)
 			{
-				struct tm * ptm = std::gmtime(const_cast<const time_t *>(&x));
-
-				m_params[param_index].type.timestamp.year = ptm->tm_year + 1900;
-				m_params[param_index].type.timestamp.month = ptm->tm_mon + 1;
-				m_params[param_index].type.timestamp.day = ptm->tm_mday;
-				m_params[param_index].type.timestamp.hour = ptm->tm_hour;
-				m_params[param_index].type.timestamp.minute = ptm->tm_min;
-				m_params[param_index].type.timestamp.second = ptm->tm_sec;
-
-				m_bind[param_index].buffer_type = MYSQL_TYPE_TIMESTAMP;
-				m_bind[param_index].buffer = &m_params[param_index].type.timestamp;
-
-				m_bind[param_index].is_null = const_cast<my_bool *>(&mysql_util::no);
+				// std::gmtime is not thread safe
+				datetime_value v = datetime_parser::from_timestamp(x);
+
+				std::memset(&m_params[i].type.timestamp, 0, sizeof(MYSQL_TIME));
+				m_params[i].type.timestamp.year = (unsigned int)v.year;
+				m_params[i].type.timestamp.month = (unsigned int)v.month;
+				m_params[i].type.timestamp.day = (unsigned int)v.day;
+				m_params[i].type.timestamp.hour = (unsigned int)v.hour;
+				m_params[i].type.timestamp.minute = (unsigned int)v.minute;
+				m_params[i].type.timestamp.second = (unsigned int)v.second;
+				m_params[i].type.timestamp.time_type = MYSQL_TIMESTAMP_DATETIME;
+
+				m_bind[i].buffer_type = MYSQL_TYPE_TIMESTAMP;
+				m_bind[i].buffer = &m_params[i].type.timestamp;
+
+				m_bind[i].is_null = const_cast<my_bool *>(&mysql_util::no);
 			}
 		}
 
@@ -263,22 +303,49 @@ namespace zdb2
 		 */
 		virtual void execute() override
 		{
-			if (m_param_count > 0 && m_stmt && m_bind && m_params)
-			{
-				if (mysql_util::MYSQL_OK != mysql_stmt_bind_param(m_stmt, m_bind))
-					throw std::runtime_error(mysql_stmt_error(m_stmt));
+			if (!m_stmt)
+				throw std::runtime_error(mysql_error(m_db));
 
-#if MYSQL_VERSION_ID >= 50002
-				unsigned long cursor = CURSOR_TYPE_NO_CURSOR;
-				mysql_stmt_attr_set(m_stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
-#endif
+			tracer * t = _tracer();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
 
-				if ((mysql_util::MYSQL_OK != mysql_stmt_execute(m_stmt)))
-					throw std::runtime_error(mysql_stmt_error(m_stmt));
+			_traced_execute(t, start, CURSOR_TYPE_NO_CURSOR);
 
-				/* Discard prepared param data in client/server */
-				mysql_stmt_reset(m_stmt);
-			}
+			/* Discard prepared param data in client/server */
+			mysql_stmt_reset(m_stmt);
+
+			if (t)
+				_trace_execute(*t, start);
+
+			_executed();
+		}
+
+
+		/**
+		 * Executes the prepared SQL statement,which returns a single ResultSet object.
+		 * The ResultSet uses this statement,it "lives" only until the statement is 
+		 * executed again or closed.
+		 * @param P A PreparedStatement object
+		 * @return A ResultSet object that contains the data produced by the prepared
+		 * statement.
+		 * @exception SQLException If a database error occurs
+		 */
+		virtual std::shared_ptr<resultset> query() override
+		{
+			if (!m_stmt)
+				throw std::runtime_error(mysql_error(m_db));
+
+			tracer * t = _tracer();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			_traced_execute(t, start, CURSOR_TYPE_READ_ONLY);
+
+			std::shared_ptr<mysql_resultset> rs = std::make_shared<mysql_resultset>(m_stmt, m_timeout, shared_from_this());
+
+			if (t)
+				_trace_query(*t, start, *rs);
+
+			return rs;
 		}
 
 
@@ -296,6 +363,41 @@ namespace zdb2
 		}
 
 
+		/**
+		 * Returns the sql text with the values of the parameters in place of the
+		 * placeholders,the strings are quoted and the blobs are written in hex.
+		 * @param P A PreparedStatement object
+		 */
+		virtual std::string get_expanded_sql() override
+		{
+			if (!m_bind || !m_params || m_param_count <= 0)
+				return m_sql;
+
+			std::string s;
+			s.reserve(m_sql.size() * 2);
+
+			sql_scanner scanner(m_sql.c_str());
+			sql_token token;
+			const char * p = m_sql.c_str();
+			int i = 0;
+			while (scanner.next(token))
+			{
+				if (token.type != sql_token_type::parameter || token.data[0] != '?')
+					continue;
+
+				s.append(p, token.data);
+				p = token.data + token.size;
+
+				if (i < m_param_count)
+					_append_param(s, i++);
+				else
+					s += '?';
+			}
+			s.append(p);
+			return s;
+		}
+
+
 		/** @name Properties */
 		//@{
 
@@ -304,6 +406,158 @@ namespace zdb2
 		
 
 	protected:
+		/**
+		 * map the 1-based parameter index to the slot of m_bind and m_params.
+		 * @exception SQLException If the parameter index is out of range
+		 */
+		int _param_index(int param_index)
+		{
+			// the first parameter is 1
+			if (param_index < 1 || param_index > m_param_count)
+				throw std::runtime_error("parameter index is out of range.");
+			return param_index - 1;
+		}
+
+		/**
+		 * append the value of the parameter as a sql literal.
+		 */
+		void _append_param(std::string & s, int i)
+		{
+			const MYSQL_BIND & bind = m_bind[i];
+
+			if (bind.buffer_type == MYSQL_TYPE_NULL || !bind.buffer || (bind.is_null && *bind.is_null))
+			{
+				s += "NULL";
+				return;
+			}
+
+			char buf[64];
+			switch (bind.buffer_type)
+			{
+			case MYSQL_TYPE_LONG:
+				std::snprintf(buf, sizeof(buf), "%d", m_params[i].type.integer);
+				s += buf;
+				break;
+			case MYSQL_TYPE_LONGLONG:
+				std::snprintf(buf, sizeof(buf), "%lld", m_params[i].type.llong);
+				s += buf;
+				break;
+			case MYSQL_TYPE_DOUBLE:
+				std::snprintf(buf, sizeof(buf), "%.17g", m_params[i].type.real);
+				s += buf;
+				break;
+			case MYSQL_TYPE_TIMESTAMP:
+				{
+					const MYSQL_TIME & t = m_params[i].type.timestamp;
+					std::snprintf(buf, sizeof(buf), "'%04u-%02u-%02u %02u:%02u:%02u'",
+						t.year, t.month, t.day, t.hour, t.minute, t.second);
+					s += buf;
+				}
+				break;
+			case MYSQL_TYPE_BLOB:
+				{
+					static const char hex[] = "0123456789ABCDEF";
+					const unsigned char * data = (const unsigned char *)bind.buffer;
+					s += "X'";
+					for (unsigned long n = 0; n < m_params[i].length; n++)
+					{
+						s += hex[data[n] >> 4];
+						s += hex[data[n] & 0x0f];
+					}
+					s += '\'';
+				}
+				break;
+			default:
+				{
+					const char * data = (const char *)bind.buffer;
+					s += '\'';
+					for (unsigned long n = 0; n < m_params[i].length; n++)
+					{
+						if (data[n] == '\'')
+							s += '\'';
+						s += data[n];
+					}
+					s += '\'';
+				}
+				break;
+			}
+		}
+
+		/**
+		 * execute the statement,and record it as failed if it throws.
+		 */
+		void _traced_execute(tracer * t, std::chrono::steady_clock::time_point start, unsigned long cursor)
+		{
+			if (!t)
+			{
+				_execute(cursor);
+				return;
+			}
+
+			try
+			{
+				_execute(cursor);
+			}
+			catch (...)
+			{
+				_trace_execute(*t, start, true);
+				throw;
+			}
+		}
+
+		void _execute(unsigned long cursor)
+		{
+			if (m_param_count > 0 && mysql_util::MYSQL_OK != mysql_stmt_bind_param(m_stmt, m_bind))
+				throw std::runtime_error(mysql_stmt_error(m_stmt));
+
+#if MYSQL_VERSION_ID >= 50002
+			mysql_stmt_attr_set(m_stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
+#endif
+
+			if (mysql_util::MYSQL_OK == mysql_stmt_execute(m_stmt))
+				return;
+
+			// the server side statement is lost after a reconnection,or must be prepared again
+			// after the schema is changed,the statement may be cached for a long time,so prepare
+			// it again with the same parameters and retry once.
+			if (mysql_util::is_reprepare_error(mysql_stmt_errno(m_stmt)) && _reprepare())
+			{
+				if (m_param_count > 0 && mysql_util::MYSQL_OK != mysql_stmt_bind_param(m_stmt, m_bind))
+					throw std::runtime_error(mysql_stmt_error(m_stmt));
+
+#if MYSQL_VERSION_ID >= 50002
+				mysql_stmt_attr_set(m_stmt, STMT_ATTR_CURSOR_TYPE, &cursor);
+#endif
+
+				if (mysql_util::MYSQL_OK == mysql_stmt_execute(m_stmt))
+					return;
+			}
+
+			throw std::runtime_error(mysql_stmt_error(m_stmt));
+		}
+
+		/**
+		 * prepare the sql again on the server,the parameters are kept.
+		 */
+		bool _reprepare()
+		{
+			MYSQL_STMT * new_stmt = mysql_stmt_init(m_db);
+			if (!new_stmt)
+				return false;
+
+			if (mysql_util::MYSQL_OK != mysql_stmt_prepare(new_stmt, m_sql.c_str(), (unsigned long)m_sql.length()) ||
+				(int)mysql_stmt_param_count(new_stmt) != m_param_count)
+			{
+				mysql_stmt_close(new_stmt);
+				return false;
+			}
+
+			mysql_stmt_close(m_stmt);
+			m_stmt = new_stmt;
+
+			return true;
+		}
+
 		virtual void _init() override
 		{
 			if (!m_sql.empty())
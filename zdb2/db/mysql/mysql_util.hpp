@@ -36,6 +36,26 @@ namespace zdb2
 
 		const static int STRLEN = 256;
 
+		/// server error codes from mysqld_error.h,which is not included by mysql.h
+		const static unsigned int ER_UNKNOWN_STMT_HANDLER = 1243;
+		const static unsigned int ER_NEED_REPREPARE = 1615;
+
+		/// the maximum number of placeholders in a prepared statement
+		const static std::size_t MAX_PLACEHOLDERS = 65535;
+
+		/// the max_allowed_packet of the old servers,used when the server value can't be read
+		const static std::size_t DEFAULT_MAX_ALLOWED_PACKET = 1024 * 1024;
+
+		/**
+		 * Returns true if the prepared statement is lost on the server or is out of date,
+		 * and must be prepared again.
+		 */
+		static bool is_reprepare_error(unsigned int error)
+		{
+			return (error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST ||
+				error == ER_UNKNOWN_STMT_HANDLER || error == ER_NEED_REPREPARE);
+		}
+
 		typedef struct param_t {
 			union {
 				int integer;
@@ -51,8 +71,33 @@ namespace zdb2
 			MYSQL_FIELD * field;
 			unsigned long length;
 			char * buffer;
+
+			/// the DATE,TIME,DATETIME and TIMESTAMP columns are fetched into the MYSQL_TIME
+			bool is_time;
+			MYSQL_TIME time;
 		} column_t;
 
+		/**
+		 * Returns the buffer type of a temporal field type,or MYSQL_TYPE_NULL if it is not temporal.
+		 */
+		static enum_field_types temporal_type(int type)
+		{
+			switch (type)
+			{
+			case MYSQL_TYPE_DATE:
+			case MYSQL_TYPE_NEWDATE:
+				return MYSQL_TYPE_DATE;
+			case MYSQL_TYPE_TIME:
+				return MYSQL_TYPE_TIME;
+			case MYSQL_TYPE_DATETIME:
+				return MYSQL_TYPE_DATETIME;
+			case MYSQL_TYPE_TIMESTAMP:
+				return MYSQL_TYPE_TIMESTAMP;
+			default:
+				return MYSQL_TYPE_NULL;
+			}
+		}
+
 	};
 
 
@@ -106,17 +106,6 @@ namespace zdb2
 			return m_columns[column_index].field->name;
 		}
 
-		/**
-		 * @function : get column index by column name
-		 */
-		virtual int get_column_index(const char * column_name) override
-		{
-			auto iterator = m_column_name_map.find(column_name);
-			if (iterator != m_column_name_map.end())
-				return iterator->second;
-			return -1;
-		}
-
 		/**
 		 * Returns column size in bytes. If the column is a blob then 
 		 * this method returns the number of bytes in that blob. No type 
@@ -476,8 +465,8 @@ namespace zdb2
 		 */
 		virtual time_t get_timestamp(int column_index) override
 		{
-			// Not integer storage class, try to parse as time string
-			return (time_t)0;
+			auto s = get_string(column_index);
+			return datetime_parser::to_timestamp(_parse_datetime(s, (s ? std::strlen(s) : 0)));
 		}
 
 
@@ -544,23 +533,8 @@ namespace zdb2
 		 */
 		virtual tm get_datetime(int column_index) override
 		{
-			struct tm tm = { 0 };
-			if (!m_stmt)
-				return tm;
-			//if (sqlite3_column_type(m_stmt, column_index) == SQLITE_INTEGER)
-			//{
-			//	time_t utc = (time_t)sqlite3_column_int64(m_stmt, column_index);
-			//	struct tm * utc_tm = std::gmtime(&utc);
-			//	if (utc_tm)
-			//		utc_tm->tm_year += 1900; // Use year literal
-			//	return (*utc_tm);
-			//}
-			//else
-			//{
-			//	// Not integer storage class, try to parse as time string
-
-			//}
-			return tm;
+			auto s = get_string(column_index);
+			return datetime_parser::to_tm(_parse_datetime(s, (s ? std::strlen(s) : 0)));
 		}
 
 
@@ -628,8 +602,6 @@ namespace zdb2
 
 		MYSQL_RES * m_meta = nullptr;
 
-		std::unordered_map<std::string, int> m_column_name_map;
-
 		MYSQL_BIND * m_bind = nullptr;
 
 		mysql_util::column_t * m_columns = nullptr;
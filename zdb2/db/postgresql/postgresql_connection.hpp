@@ -23,6 +23,7 @@
 
 #include <zdb2/config.hpp>
 #include <zdb2/net/url.hpp>
+#include <zdb2/util/format_buffer.hpp>
 #include <zdb2/db/connection.hpp>
 
 #include <zdb2/db/postgresql/postgresql_util.hpp>
@@ -59,7 +60,7 @@ namespace zdb2
 		 * @param ms The query timeout limit in milliseconds; zero means
 		 * there is no limit
 		 */
-		void set_query_timeout(std::size_t ms)
+		virtual void set_query_timeout(std::size_t ms) override
 		{
 			connection::set_query_timeout(ms);
 
@@ -217,16 +218,11 @@ namespace zdb2
 			if (!sql || sql[0] == '\0')
 				return false;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
-			
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
 
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
 			
@@ -257,16 +253,11 @@ namespace zdb2
 			if (!m_db || !sql || sql[0] == '\0')
 				return nullptr;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
 
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
-
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
 
@@ -318,16 +309,11 @@ namespace zdb2
 			if (!sql || sql[0] == '\0')
 				return nullptr;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
 
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
-
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
 
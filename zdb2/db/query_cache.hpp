@@ -0,0 +1,506 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <type_traits>
+
+#include <zdb2/config.hpp>
+#include <zdb2/util/sql_scanner.hpp>
+#include <zdb2/db/stmt.hpp>
+#include <zdb2/db/rowset.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the statistics of the query cache,see pool::get_query_cache_stats.
+	 */
+	struct query_cache_stats
+	{
+		std::uint64_t hits = 0;
+		std::uint64_t misses = 0;
+
+		/// the entries removed to keep the memory under the budget
+		std::uint64_t evictions = 0;
+
+		/// the entries removed because they are older than the ttl
+		std::uint64_t expirations = 0;
+
+		/// the entries removed because a table of them is written
+		std::uint64_t invalidations = 0;
+
+		std::size_t entries = 0;
+
+		std::size_t memory = 0;
+		std::size_t capacity = 0;
+	};
+
+	/**
+	 * the materialized results of the queries keyed by the normalized sql and the parameters,the
+	 * least recently used results are evicted when the memory budget is exceeded,and a result is
+	 * dropped when it is older than the ttl or a table it reads is written.it is thread safe.
+	 */
+	class query_cache
+	{
+	public:
+		query_cache(
+			std::size_t capacity = zdb2::DEFAULT_QUERY_CACHE_SIZE,
+			std::chrono::milliseconds ttl = std::chrono::milliseconds(zdb2::DEFAULT_QUERY_CACHE_TTL)
+		)
+			: m_capacity(capacity)
+			, m_ttl(ttl)
+		{
+		}
+
+		~query_cache()
+		{
+		}
+
+		/**
+		 * Make the key of the query,the sql is normalized (the comments are removed and the white
+		 * spaces are collapsed),and the parameters are appended with their types.
+		 */
+		template<typename... Args>
+		static std::string make_key(const char * sql, const Args&... args)
+		{
+			std::string key = normalize(sql);
+			key += '\0';
+			_append_from(key, args...);
+			return key;
+		}
+
+		static std::string normalize(const char * sql)
+		{
+			std::string s;
+			sql_scanner scanner(sql);
+			sql_token token;
+			while (scanner.next(token))
+			{
+				if (!s.empty())
+					s += ' ';
+				s.append(token.data, token.size);
+			}
+			return s;
+		}
+
+		/**
+		 * Find the tables read or written by the statements,the names are in lower case without the
+		 * schema and the quotes.
+		 * @return true if a statement writes the tables (INSERT,UPDATE,DELETE,REPLACE or DDL)
+		 */
+		static bool parse_tables(const char * sql, std::vector<std::string> & tables)
+		{
+			sql_scanner scanner(sql);
+			sql_token token;
+			bool write = false, first = true;
+
+			while (scanner.next(token))
+			{
+				if (token.is(';'))
+				{
+					first = true;
+					continue;
+				}
+
+				if (first)
+				{
+					write = write || token.is("insert") || token.is("update") || token.is("delete") || token.is("replace") ||
+						token.is("create") || token.is("drop") || token.is("alter") || token.is("truncate") ||
+						token.is("merge");
+					first = false;
+				}
+
+				bool list = token.is("from");
+				if (list || token.is("join") || token.is("update") || token.is("into") || token.is("table") || token.is("truncate"))
+				{
+					_read_tables(scanner, token, list, tables);
+				}
+			}
+
+			std::sort(tables.begin(), tables.end());
+			tables.erase(std::unique(tables.begin(), tables.end()), tables.end());
+
+			return write;
+		}
+
+		/**
+		 * Returns the cached result of the key,nullptr if it is not cached or expired.
+		 */
+		std::shared_ptr<rowset> get(const std::string & key)
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+
+			auto it = m_map.find(key);
+			if (it == m_map.end())
+			{
+				m_stats.misses++;
+				return nullptr;
+			}
+
+			if (std::chrono::steady_clock::now() - it->second->time > m_ttl)
+			{
+				_erase(it->second);
+				m_stats.expirations++;
+				m_stats.misses++;
+				return nullptr;
+			}
+
+			m_list.splice(m_list.begin(), m_list, it->second);
+
+			m_stats.hits++;
+			return it->second->rows;
+		}
+
+		/**
+		 * Returns the ticket of a query which is about to run,the result of it is not cached if a
+		 * table is invalidated before the result is put,so a write which runs at the same time as
+		 * the query never leaves a stale result in the cache.
+		 */
+		std::uint64_t get_ticket()
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+			return m_generation;
+		}
+
+		/**
+		 * Cache the result of the query,it is dropped when one of the tables is written.
+		 * @return false if the result is not cached
+		 */
+		bool put(const std::string & key, const std::vector<std::string> & tables, std::shared_ptr<rowset> rows, std::uint64_t ticket)
+		{
+			if (!rows)
+				return false;
+
+			std::size_t size = key.size() + rows->get_memory_size() + sizeof(entry_t) + 64;
+
+			std::lock_guard<std::mutex> g(m_lock);
+
+			if (size > m_capacity)
+				return false;
+
+			for (auto & table : tables)
+			{
+				auto it = m_invalidated.find(table);
+				if (it != m_invalidated.end() && it->second > ticket)
+					return false;
+			}
+
+			auto it = m_map.find(key);
+			if (it != m_map.end())
+				_erase(it->second);
+
+			while (!m_list.empty() && m_memory + size > m_capacity)
+			{
+				_erase(std::prev(m_list.end()));
+				m_stats.evictions++;
+			}
+
+			m_list.emplace_front();
+			entry_t & e = m_list.front();
+			e.key = key;
+			e.tables = tables;
+			e.rows = std::move(rows);
+			e.size = size;
+			e.time = std::chrono::steady_clock::now();
+
+			m_map.emplace(e.key, m_list.begin());
+			for (auto & table : e.tables)
+				m_tables.emplace(table, m_list.begin());
+
+			m_memory += size;
+			return true;
+		}
+
+		/**
+		 * Drop the cached results which read the table.
+		 * @param table The table name,case insensitive
+		 */
+		void invalidate(const std::string & table)
+		{
+			std::string name = table;
+			for (auto & c : name)
+				c = (char)std::tolower((unsigned char)c);
+
+			std::lock_guard<std::mutex> g(m_lock);
+			_invalidate(name);
+		}
+
+		void invalidate(const std::vector<std::string> & tables)
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+			for (auto & table : tables)
+				_invalidate(table);
+		}
+
+		/**
+		 * Drop the cached results which read the tables written by the statement.
+		 * @return true if the statement is a write
+		 */
+		bool invalidate_sql(const char * sql)
+		{
+			std::vector<std::string> tables;
+			if (!parse_tables(sql, tables))
+				return false;
+			invalidate(tables);
+			return true;
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+			m_tables.clear();
+			m_map.clear();
+			m_list.clear();
+			m_memory = 0;
+		}
+
+		void set_capacity(std::size_t capacity)
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+			m_capacity = capacity;
+			while (!m_list.empty() && m_memory > m_capacity)
+			{
+				_erase(std::prev(m_list.end()));
+				m_stats.evictions++;
+			}
+		}
+
+		void set_ttl(std::chrono::milliseconds ttl)
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+			m_ttl = ttl;
+		}
+
+		query_cache_stats get_stats()
+		{
+			std::lock_guard<std::mutex> g(m_lock);
+			query_cache_stats s = m_stats;
+			s.entries = m_list.size();
+			s.memory = m_memory;
+			s.capacity = m_capacity;
+			return s;
+		}
+
+	private:
+		/// no copy construct function
+		query_cache(const query_cache&) = delete;
+
+		/// no operator equal function
+		query_cache& operator=(const query_cache&) = delete;
+
+	protected:
+
+		struct entry_t
+		{
+			std::string key;
+			std::vector<std::string> tables;
+			std::shared_ptr<rowset> rows;
+			std::size_t size = 0;
+			std::chrono::steady_clock::time_point time;
+		};
+
+		typedef std::list<entry_t> list_type;
+
+		/// read the table names after FROM (a list),JOIN,UPDATE,INTO,TABLE and TRUNCATE
+		static void _read_tables(sql_scanner & scanner, sql_token & token, bool list, std::vector<std::string> & tables)
+		{
+			for (;;)
+			{
+				if (!scanner.next(token))
+					return;
+
+				// IF [NOT] EXISTS of the DDL,the sub query "from (select ...)" is read by the caller
+				while (token.is("if") || token.is("not") || token.is("exists") || token.is("only") || token.is("table"))
+				{
+					if (!scanner.next(token))
+						return;
+				}
+
+				if (token.type != sql_token_type::identifier && token.type != sql_token_type::quoted_identifier)
+					return;
+
+				std::string name = token.name();
+
+				// schema.table
+				sql_scanner peek = scanner;
+				sql_token dot;
+				while (peek.next(dot) && dot.is('.') && peek.next(dot) &&
+					(dot.type == sql_token_type::identifier || dot.type == sql_token_type::quoted_identifier))
+				{
+					name = dot.name();
+					scanner = peek;
+				}
+
+				tables.push_back(name);
+
+				if (!list)
+					return;
+
+				// [AS] alias,and the next table after a comma
+				peek = scanner;
+				if (!peek.next(token))
+					return;
+				if (token.is("as") && !peek.next(token))
+					return;
+				if ((token.type == sql_token_type::identifier && !_is_clause(token)) || token.type == sql_token_type::quoted_identifier)
+				{
+					scanner = peek;
+					if (!peek.next(token))
+						return;
+				}
+				if (!token.is(','))
+					return;
+				scanner = peek;
+			}
+		}
+
+		static bool _is_clause(const sql_token & token)
+		{
+			return token.is("where") || token.is("join") || token.is("inner") || token.is("left") || token.is("right") ||
+				token.is("full") || token.is("cross") || token.is("natural") || token.is("on") || token.is("group") ||
+				token.is("order") || token.is("limit") || token.is("having") || token.is("union") || token.is("set") ||
+				token.is("values") || token.is("select") || token.is("using") || token.is("offset") || token.is("for") ||
+				token.is("window") || token.is("except") || token.is("intersect") || token.is("returning");
+		}
+
+		void _invalidate(const std::string & table)
+		{
+			m_invalidated[table] = ++m_generation;
+
+			auto range = m_tables.equal_range(table);
+			std::vector<list_type::iterator> entries;
+			for (auto it = range.first; it != range.second; it++)
+				entries.push_back(it->second);
+
+			for (auto e : entries)
+			{
+				_erase(e);
+				m_stats.invalidations++;
+			}
+		}
+
+		void _erase(list_type::iterator e)
+		{
+			for (auto & table : e->tables)
+			{
+				auto range = m_tables.equal_range(table);
+				for (auto it = range.first; it != range.second; it++)
+				{
+					if (it->second == e)
+					{
+						m_tables.erase(it);
+						break;
+					}
+				}
+			}
+			m_map.erase(e->key);
+			m_memory -= e->size;
+			m_list.erase(e);
+		}
+
+		static void _append_from(std::string &)
+		{
+		}
+
+		template<typename T, typename... Args>
+		static void _append_from(std::string & key, const T & x, const Args&... args)
+		{
+			_append(key, x);
+			_append_from(key, args...);
+		}
+
+		static void _append_bytes(std::string & key, char type, const void * data, std::size_t size)
+		{
+			key += type;
+			key.append((const char *)&size, sizeof(size));
+			key.append((const char *)data, size);
+		}
+
+		template<typename T>
+		static typename std::enable_if<std::is_integral<T>::value>::type _append(std::string & key, T x)
+		{
+			int64_t v = (int64_t)x;
+			_append_bytes(key, 'i', &v, sizeof(v));
+		}
+
+		template<typename T>
+		static typename std::enable_if<std::is_floating_point<T>::value>::type _append(std::string & key, T x)
+		{
+			double v = (double)x;
+			_append_bytes(key, 'd', &v, sizeof(v));
+		}
+
+		static void _append(std::string & key, const char * x)
+		{
+			if (x)
+				_append_bytes(key, 's', x, std::strlen(x));
+			else
+				key += 'n';
+		}
+
+		static void _append(std::string & key, const std::string & x)
+		{
+			_append_bytes(key, 's', x.data(), x.size());
+		}
+
+		static void _append(std::string & key, std::nullptr_t)
+		{
+			key += 'n';
+		}
+
+		static void _append(std::string & key, const blob & x)
+		{
+			_append_bytes(key, 'b', x.data, x.size);
+		}
+
+		static void _append(std::string & key, const timestamp & x)
+		{
+			_append_bytes(key, 't', &x.value, sizeof(x.value));
+		}
+
+	protected:
+
+		std::mutex m_lock;
+
+		std::size_t m_capacity = zdb2::DEFAULT_QUERY_CACHE_SIZE;
+
+		std::chrono::milliseconds m_ttl;
+
+		std::size_t m_memory = 0;
+
+		/// the most recently used result is at the front
+		list_type m_list;
+
+		std::unordered_map<std::string, list_type::iterator> m_map;
+
+		/// the table names to the results which read the table
+		std::unordered_multimap<std::string, list_type::iterator> m_tables;
+
+		/// the generation of the last invalidation of every table,see get_ticket
+		std::unordered_map<std::string, std::uint64_t> m_invalidated;
+
+		std::uint64_t m_generation = 0;
+
+		query_cache_stats m_stats;
+	};
+
+}
@@ -11,19 +11,43 @@
 #pragma once
 
 #include <cctype>
+#include <cstring>
 #include <string>
 #include <memory>
 #include <algorithm>
 #include <mutex>
 #include <stdexcept>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 
 #include <zdb2/config.hpp>
+#include <zdb2/db/column_buffer.hpp>
+#include <zdb2/db/column_handle.hpp>
+#include <zdb2/db/rowset.hpp>
+#include <zdb2/db/tracer.hpp>
+#include <zdb2/util/datetime_parser.hpp>
+
+#if defined(ZDB2_HAS_STRING_VIEW)
+#include <string_view>
+#endif
+
+#if defined(ZDB2_HAS_SPAN)
+#include <cstddef>
+#include <span>
+#endif
 
 namespace zdb2
 {
 
+	class connection;
+	class stmt;
+
 	class resultset
 	{
+		friend class connection;
+		friend class stmt;
+
 	public:
 		resultset(std::size_t timeout = zdb2::DEFAULT_TIMEOUT) : m_timeout(timeout)
 		{
@@ -54,7 +78,69 @@ namespace zdb2
 		 */
 		virtual const char * get_column_name(int column_index) = 0;
 
-		virtual int get_column_index(const char * column_name) = 0;
+		/**
+		 * Returns the index of the designated column by its name. The name map
+		 * is built by the first lookup and keeps only the hashes of the names,
+		 * so a ResultSet read only by index never builds it.
+		 * @param R A ResultSet object
+		 * @param columnName The SQL name of the column. <i>case-sensitive</i>
+		 * @return The column index,-1 if the column does not exist
+		 */
+		virtual int get_column_index(const char * column_name)
+		{
+			if (!column_name)
+				return -1;
+
+			if (!m_column_names_built)
+			{
+				int count = get_column_count();
+				m_column_names.reserve((std::size_t)(count > 0 ? count : 0));
+				for (int i = 0; i < count; i++)
+				{
+					const char * name = get_column_name(i);
+					if (name)
+						m_column_names.emplace(_hash(name), i);
+				}
+				m_column_names_built = true;
+			}
+
+			// the names are not kept,sqlite frees them when the statement is compiled again
+			auto range = m_column_names.equal_range(_hash(column_name));
+			for (auto it = range.first; it != range.second; it++)
+			{
+				const char * name = get_column_name(it->second);
+				if (name && std::strcmp(name, column_name) == 0)
+					return it->second;
+			}
+			return -1;
+		}
+
+		/**
+		 * Resolve the designated column by its name once,the handle is passed
+		 * to the getters instead of the name,so the rows are read without a 
+		 * name lookup. The handle is valid for every ResultSet of the same sql.
+		 * eg : auto id = rs->column("id"); while (rs->next_row()) rs->get_int64(id);
+		 * @param R A ResultSet object
+		 * @param columnName The SQL name of the column. <i>case-sensitive</i>
+		 * @return The column handle,check it by column_handle::valid
+		 */
+		column_handle column(const char * column_name)
+		{
+			return column_handle(get_column_index(column_name));
+		}
+
+		/**
+		 * Returns the type the values of the designated column are best read as,
+		 * from the declared type of the column. It is column_type::text if the 
+		 * type is unknown.
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @return The column type
+		 */
+		virtual column_type get_column_type(int /*column_index*/)
+		{
+			return column_type::text;
+		}
 
 		/**
 		 * Returns column size in bytes. If the column is a blob then 
@@ -86,6 +172,118 @@ namespace zdb2
 		 */
 		virtual bool next_row() = 0;
 
+
+		/**
+		 * Moves the cursor down up to <code>n</code> rows and appends the values
+		 * of every row to the column buffers,the first buffer receives the first
+		 * column and so on,the columns without a buffer are skipped. The values
+		 * are converted to the column_type of the buffer,the buffers are cleared
+		 * first. The backends fetch the rows in a tight loop without a virtual 
+		 * call per value,this default fetches them by next_row and the getters.
+		 * eg : std::vector<column_buffer> cols{ column_buffer(column_type::int64) };
+		 *      while (rs->fetch_batch(1024, cols) > 0) { ... cols[0].int64_data() ... }
+		 * @param R A ResultSet object
+		 * @param n The maximum number of rows to fetch
+		 * @param columns The column buffers
+		 * @return The number of rows fetched,0 if there are no more rows
+		 * @exception SQLException If a database access error occurs
+		 */
+		virtual std::size_t fetch_batch(std::size_t n, std::vector<column_buffer> & columns)
+		{
+			int count = std::min((int)columns.size(), get_column_count());
+
+			for (auto & column : columns)
+				column.clear();
+
+			std::size_t rows = 0;
+			while (rows < n && next_row())
+			{
+				for (int i = 0; i < count; i++)
+				{
+					column_buffer & column = columns[i];
+
+					if (is_null(i))
+					{
+						column.push_null();
+						continue;
+					}
+
+					switch (column.get_type())
+					{
+					case column_type::int64:
+						column.push_int64(get_int64(i));
+						break;
+					case column_type::real:
+						column.push_double(get_double(i));
+						break;
+					case column_type::text:
+						{
+							std::size_t size = 0;
+							const char * text = get_text(i, &size);
+							column.push_bytes(text, size);
+						}
+						break;
+					case column_type::blob:
+						{
+							std::size_t size = 0;
+							const void * blob = get_blob(i, &size);
+							column.push_bytes(blob, size);
+						}
+						break;
+					}
+				}
+				rows++;
+			}
+			return rows;
+		}
+
+		/**
+		 * Fetch all the remaining rows into a RowSet,which don't use the 
+		 * connection,so the connection can be returned to the pool right after
+		 * this call. The values are stored as the get_column_type of every
+		 * column.
+		 * eg : auto rows = conn->select("select * from t")->materialize();
+		 * @param R A ResultSet object
+		 * @return A immutable RowSet object which can be shared by threads
+		 * @exception SQLException If a database access error occurs
+		 */
+		std::shared_ptr<rowset> materialize()
+		{
+			std::vector<column_type> types;
+			int count = get_column_count();
+			for (int i = 0; i < count; i++)
+				types.push_back(get_column_type(i));
+			return materialize(types);
+		}
+
+		/**
+		 * Fetch all the remaining rows into a RowSet,the values of every column
+		 * are stored as the given type,see materialize().
+		 * @param R A ResultSet object
+		 * @param types The column types,one per column
+		 * @return A immutable RowSet object which can be shared by threads
+		 * @exception SQLException If a database access error occurs
+		 */
+		std::shared_ptr<rowset> materialize(const std::vector<column_type> & types)
+		{
+			int count = get_column_count();
+			if ((int)types.size() != count)
+				throw std::runtime_error("the column count don't match the types.");
+
+			std::vector<std::string> names;
+			std::vector<column_buffer> columns;
+			for (int i = 0; i < count; i++)
+			{
+				const char * name = get_column_name(i);
+				names.emplace_back(name ? name : "");
+				columns.emplace_back(types[i]);
+			}
+
+			fetch_batch((std::size_t)-1, columns);
+
+			return std::make_shared<rowset>(names, columns);
+		}
+
 		/** @name Columns */
 		//@{
 
@@ -293,6 +491,89 @@ namespace zdb2
 		 */
 		virtual const void * get_blob(const char * column_name, std::size_t * size) = 0;
 
+
+		/**
+		 * Retrieves the value of the designated column in the current row of
+		 * this ResultSet object as a pointer to the text and its length,the
+		 * length is known by the backend,so the text is not copied or scanned
+		 * for the terminator,and <i>it may not be NUL terminated</i>. The text
+		 * is valid until the next call to next_row() or close().
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @param size The number of bytes in the text is stored in size 
+		 * @return The column value; if the value is SQL NULL, the value
+		 * returned is NULL and the size is 0
+		 * @exception SQLException If a database access error occurs or 
+		 * columnIndex is outside the valid range
+		 */
+		virtual const char * get_text(int column_index, std::size_t * size)
+		{
+			const char * text = get_string(column_index);
+			if (size)
+				*size = (text ? std::strlen(text) : 0);
+			return text;
+		}
+
+		const char * get_text(const char * column_name, std::size_t * size)
+		{
+			int col_index = get_column_index(column_name);
+			if (col_index < 0)
+			{
+				if (size)
+					*size = 0;
+				return nullptr;
+			}
+			return get_text(col_index, size);
+		}
+
+#if defined(ZDB2_HAS_STRING_VIEW)
+		/**
+		 * Retrieves the value of the designated column in the current row of
+		 * this ResultSet object as a std::string_view,see get_text. The view 
+		 * is valid until the next call to next_row() or close().
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @return The column value; if the value is SQL NULL, a empty view
+		 */
+		std::string_view get_string_view(int column_index)
+		{
+			std::size_t size = 0;
+			const char * text = get_text(column_index, &size);
+			return (text ? std::string_view(text, size) : std::string_view());
+		}
+
+		std::string_view get_string_view(const char * column_name)
+		{
+			std::size_t size = 0;
+			const char * text = get_text(column_name, &size);
+			return (text ? std::string_view(text, size) : std::string_view());
+		}
+#endif
+
+#if defined(ZDB2_HAS_SPAN)
+		/**
+		 * Retrieves the value of the designated column in the current row of
+		 * this ResultSet object as a span of bytes,see get_blob. The span is
+		 * valid until the next call to next_row() or close().
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @return The column value; if the value is SQL NULL, a empty span
+		 */
+		std::span<const std::byte> get_bytes(int column_index)
+		{
+			std::size_t size = 0;
+			const void * blob = get_blob(column_index, &size);
+			return (blob ? std::span<const std::byte>((const std::byte *)blob, size) : std::span<const std::byte>());
+		}
+
+		std::span<const std::byte> get_bytes(const char * column_name)
+		{
+			std::size_t size = 0;
+			const void * blob = get_blob(column_name, &size);
+			return (blob ? std::span<const std::byte>((const std::byte *)blob, size) : std::span<const std::byte>());
+		}
+#endif
+
 		//@}
 
 		/** @name Date and Time  */
@@ -419,10 +700,75 @@ namespace zdb2
 	protected:
 		virtual void _init() = 0;
 
+		/// FNV-1a hash of the column name,so the lookup don't need to make a std::string
+		static std::size_t _hash(const char * name)
+		{
+			std::uint64_t h = 14695981039346656037ULL;
+			for (; *name; name++)
+			{
+				h ^= (unsigned char)(*name);
+				h *= 1099511628211ULL;
+			}
+			return (std::size_t)h;
+		}
+
+		/**
+		 * parse the text of a date,time or date and time column,see datetime_parser.The empty text is
+		 * the zero value like SQL NULL.
+		 */
+		static datetime_value _parse_datetime(const char * s, std::size_t size)
+		{
+			datetime_value v;
+			if (s && size > 0 && !datetime_parser::parse(s, size, v))
+				throw std::runtime_error("invalid date or time string.");
+			return v;
+		}
+
+		/**
+		 * add the time,the rows and the bytes of a fetch to the trace of the query,see tracer.
+		 */
+		void _trace_fetch(std::chrono::steady_clock::time_point start, std::size_t rows, std::size_t bytes)
+		{
+			m_span.fetch_time += trace_span::elapsed(start);
+			m_span.rows += rows;
+			m_span.bytes += bytes;
+		}
+
+		/**
+		 * record the query as failed when a fetch throws.
+		 */
+		void _trace_error(std::chrono::steady_clock::time_point start)
+		{
+			m_span.error = true;
+			_trace_fetch(start, 0, 0);
+			_trace_finish();
+		}
+
+		/**
+		 * record the query when all the rows are fetched or the resultset is closed.
+		 */
+		void _trace_finish()
+		{
+			if (m_tracer)
+			{
+				m_tracer->finish(m_span);
+				m_tracer.reset();
+			}
+		}
+
 	protected:
 
 		std::size_t m_timeout = zdb2::DEFAULT_TIMEOUT;
 
+		/// the hashes of the column names to the column indexes,built by the first get_column_index
+		std::unordered_multimap<std::size_t, int> m_column_names;
+
+		bool m_column_names_built = false;
+
+		/// set by the connection or the statement when the tracing is enabled,see tracer
+		std::shared_ptr<tracer> m_tracer;
+		trace_span m_span;
+
 	};
 
 }
@@ -0,0 +1,358 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+
+#include <zdb2/config.hpp>
+#include <zdb2/db/column_buffer.hpp>
+#include <zdb2/db/column_handle.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the rows of a query copied out of the resultset,see resultset::materialize.it don't use the
+	 * connection,so the connection can be returned to the pool as soon as the rows are fetched.
+	 * all the values live in one memory block : the null bitmap and the fixed width values (or
+	 * the text offsets) of every column,then the texts,blobs and column names.it is immutable,so
+	 * it can be shared and read by several threads at the same time.
+	 */
+	class rowset
+	{
+	public:
+		/**
+		 * Build the rowset from the fetched columns,used by resultset::materialize.
+		 * @param names The column names
+		 * @param columns The column values,one buffer per column,they are not kept
+		 */
+		rowset(const std::vector<std::string> & names, const std::vector<column_buffer> & columns)
+		{
+			if (names.size() != columns.size())
+				throw std::runtime_error("invalid parameters.");
+
+			m_column_count = (int)columns.size();
+			m_row_count = columns.empty() ? 0 : columns[0].size();
+
+			for (auto & column : columns)
+			{
+				if (column.size() != m_row_count)
+					throw std::runtime_error("invalid parameters.");
+			}
+
+			// lay out the fixed width arrays first,they are 8 bytes aligned
+			std::size_t words = (m_row_count + 63) / 64;
+			std::size_t size = 0;
+
+			m_columns.resize(columns.size());
+			for (std::size_t i = 0; i < columns.size(); i++)
+			{
+				column_t & c = m_columns[i];
+				c.type = columns[i].get_type();
+
+				c.nulls = size;
+				size += words * sizeof(std::uint64_t);
+
+				c.values = size;
+				switch (c.type)
+				{
+				case column_type::int64: size += m_row_count * sizeof(int64_t); break;
+				case column_type::real:  size += m_row_count * sizeof(double); break;
+				default:                 size += (m_row_count + 1) * sizeof(std::size_t); break;
+				}
+			}
+
+			// then the texts and blobs,every value is NUL terminated,so get_string needs no copy
+			std::size_t heap = size;
+			for (std::size_t i = 0; i < columns.size(); i++)
+			{
+				if (m_columns[i].type == column_type::text || m_columns[i].type == column_type::blob)
+					size += columns[i].offsets_data()[m_row_count] + m_row_count;
+			}
+			for (auto & name : names)
+			{
+				size += name.size() + 1;
+			}
+
+			m_size = (size > 0 ? size : 1);
+			m_arena.reset(new char[m_size]);
+
+			char * p = m_arena.get() + heap;
+			for (std::size_t i = 0; i < columns.size(); i++)
+			{
+				column_t & c = m_columns[i];
+				const column_buffer & column = columns[i];
+
+				if (words > 0)
+					std::memcpy(m_arena.get() + c.nulls, column.null_bitmap(), words * sizeof(std::uint64_t));
+
+				switch (c.type)
+				{
+				case column_type::int64:
+					if (m_row_count > 0)
+						std::memcpy(m_arena.get() + c.values, column.int64_data(), m_row_count * sizeof(int64_t));
+					break;
+				case column_type::real:
+					if (m_row_count > 0)
+						std::memcpy(m_arena.get() + c.values, column.double_data(), m_row_count * sizeof(double));
+					break;
+				default:
+					{
+						std::size_t * offsets = (std::size_t *)(m_arena.get() + c.values);
+						for (std::size_t row = 0; row < m_row_count; row++)
+						{
+							std::size_t n = 0;
+							const char * bytes = column.get_bytes(row, &n);
+
+							offsets[row] = (std::size_t)(p - m_arena.get());
+							if (n > 0)
+								std::memcpy(p, bytes, n);
+							p[n] = '\0';
+							p += n + 1;
+						}
+						offsets[m_row_count] = (std::size_t)(p - m_arena.get());
+					}
+					break;
+				}
+			}
+
+			for (std::size_t i = 0; i < names.size(); i++)
+			{
+				m_columns[i].name = (std::size_t)(p - m_arena.get());
+				std::memcpy(p, names[i].c_str(), names[i].size() + 1);
+				p += names[i].size() + 1;
+
+				m_column_names.emplace(names[i], (int)i);
+			}
+		}
+
+		~rowset()
+		{
+		}
+
+		/**
+		 * Returns the number of rows in this RowSet object.
+		 */
+		std::size_t get_row_count() const
+		{
+			return m_row_count;
+		}
+
+		/**
+		 * Returns the number of columns in this RowSet object.
+		 */
+		int get_column_count() const
+		{
+			return m_column_count;
+		}
+
+		/**
+		 * Returns the number of bytes of the memory block which holds the values.
+		 */
+		std::size_t get_memory_size() const
+		{
+			return m_size;
+		}
+
+		const char * get_column_name(int column_index) const
+		{
+			if (column_index < 0 || column_index >= m_column_count)
+				return nullptr;
+			return m_arena.get() + m_columns[column_index].name;
+		}
+
+		/**
+		 * Returns the column index by its name. <i>case-sensitive</i>
+		 * @return The column index,-1 if the column does not exist
+		 */
+		int get_column_index(const char * column_name) const
+		{
+			if (!column_name)
+				return -1;
+			auto iterator = m_column_names.find(column_name);
+			if (iterator != m_column_names.end())
+				return iterator->second;
+			return -1;
+		}
+
+		column_handle column(const char * column_name) const
+		{
+			return column_handle(get_column_index(column_name));
+		}
+
+		/**
+		 * Returns the type the values of the column are stored as.
+		 */
+		column_type get_column_type(int column_index) const
+		{
+			if (column_index < 0 || column_index >= m_column_count)
+				return column_type::text;
+			return m_columns[column_index].type;
+		}
+
+		/** @name Columns */
+		//@{
+
+		/**
+		 * Returns true if the value is SQL NULL,or the row or column is out of range.
+		 * @param row The first row is 0
+		 * @param column_index The first column is 0
+		 */
+		bool is_null(std::size_t row, int column_index) const
+		{
+			if (!_valid(row, column_index))
+				return true;
+			const std::uint64_t * nulls = (const std::uint64_t *)(m_arena.get() + m_columns[column_index].nulls);
+			return ((nulls[row / 64] >> (row % 64)) & 1) != 0;
+		}
+
+		/**
+		 * Returns the value as a NUL terminated string,nullptr if it is SQL NULL. The numbers
+		 * are formatted into a buffer of the caller thread,which is valid until the next call.
+		 */
+		const char * get_string(std::size_t row, int column_index) const
+		{
+			return get_text(row, column_index, nullptr);
+		}
+
+		const char * get_text(std::size_t row, int column_index, std::size_t * size) const
+		{
+			if (size)
+				*size = 0;
+
+			if (is_null(row, column_index))
+				return nullptr;
+
+			const column_t & c = m_columns[column_index];
+			switch (c.type)
+			{
+			case column_type::int64:
+			case column_type::real:
+				{
+					static thread_local char buffer[32];
+					int n = (c.type == column_type::int64) ?
+						std::snprintf(buffer, sizeof(buffer), "%lld", (long long)_int64(c, row)) :
+						std::snprintf(buffer, sizeof(buffer), "%.17g", _double(c, row));
+					if (size)
+						*size = (std::size_t)(n > 0 ? n : 0);
+					return buffer;
+				}
+			default:
+				{
+					const std::size_t * offsets = (const std::size_t *)(m_arena.get() + c.values);
+					if (size)
+						*size = offsets[row + 1] - offsets[row] - 1;
+					return m_arena.get() + offsets[row];
+				}
+			}
+		}
+
+		int get_int(std::size_t row, int column_index) const
+		{
+			return (int)get_int64(row, column_index);
+		}
+
+		/// the value of SQL NULL is 0
+		int64_t get_int64(std::size_t row, int column_index) const
+		{
+			if (is_null(row, column_index))
+				return 0;
+
+			const column_t & c = m_columns[column_index];
+			switch (c.type)
+			{
+			case column_type::int64: return _int64(c, row);
+			case column_type::real:  return (int64_t)_double(c, row);
+			default:                 return (int64_t)std::strtoll(get_string(row, column_index), nullptr, 10);
+			}
+		}
+
+		/// the value of SQL NULL is 0
+		double get_double(std::size_t row, int column_index) const
+		{
+			if (is_null(row, column_index))
+				return 0;
+
+			const column_t & c = m_columns[column_index];
+			switch (c.type)
+			{
+			case column_type::int64: return (double)_int64(c, row);
+			case column_type::real:  return _double(c, row);
+			default:                 return std::strtod(get_string(row, column_index), nullptr);
+			}
+		}
+
+		const void * get_blob(std::size_t row, int column_index, std::size_t * size) const
+		{
+			return (const void *)get_text(row, column_index, size);
+		}
+
+		//@}
+
+	protected:
+
+		struct column_t
+		{
+			column_type type = column_type::text;
+
+			/// the offsets in the arena of the null bitmap,the values or the text offsets,and the name
+			std::size_t nulls = 0;
+			std::size_t values = 0;
+			std::size_t name = 0;
+		};
+
+		bool _valid(std::size_t row, int column_index) const
+		{
+			return (row < m_row_count && column_index >= 0 && column_index < m_column_count);
+		}
+
+		int64_t _int64(const column_t & c, std::size_t row) const
+		{
+			return ((const int64_t *)(m_arena.get() + c.values))[row];
+		}
+
+		double _double(const column_t & c, std::size_t row) const
+		{
+			return ((const double *)(m_arena.get() + c.values))[row];
+		}
+
+	private:
+		/// no copy construct function
+		rowset(const rowset&) = delete;
+
+		/// no operator equal function
+		rowset& operator=(const rowset&) = delete;
+
+	protected:
+
+		std::unique_ptr<char[]> m_arena;
+
+		std::size_t m_size = 0;
+
+		std::size_t m_row_count = 0;
+
+		int m_column_count = 0;
+
+		std::vector<column_t> m_columns;
+
+		std::unordered_map<std::string, int> m_column_names;
+	};
+
+}
@@ -0,0 +1,44 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ * 
+ */
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+
+#include <zdb2/config.hpp>
+#include <zdb2/net/url.hpp>
+
+#include <zdb2/db/sqlite/sqlite_connection.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the sqlite backend for basic_pool,eg : zdb2::basic_pool<zdb2::sqlite_backend>
+	 */
+	struct sqlite_backend
+	{
+		typedef sqlite_connection connection_type;
+		typedef sqlite_resultset  resultset_type;
+		typedef sqlite_stmt       stmt_type;
+
+		static bool is_supported(const std::string & dbtype)
+		{
+			return (dbtype == "sqlite");
+		}
+
+		static connection_type * create(std::shared_ptr<url> url_ptr, std::size_t timeout)
+		{
+			return new sqlite_connection(url_ptr, timeout);
+		}
+	};
+
+}
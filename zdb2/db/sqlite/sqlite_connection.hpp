@@ -23,6 +23,7 @@
 
 #include <zdb2/config.hpp>
 #include <zdb2/net/url.hpp>
+#include <zdb2/util/format_buffer.hpp>
 #include <zdb2/db/connection.hpp>
 
 #include <zdb2/db/sqlite/sqlite_util.hpp>
@@ -32,7 +33,7 @@
 namespace zdb2
 {
 
-	class sqlite_connection : public connection
+	class sqlite_connection final : public connection
 	{
 	public:
 		sqlite_connection(
@@ -59,12 +60,17 @@ namespace zdb2
 		 * @param ms The query timeout limit in milliseconds; zero means
 		 * there is no limit
 		 */
-		void set_query_timeout(std::size_t ms)
+		virtual void set_query_timeout(std::size_t ms) override
 		{
 			connection::set_query_timeout(ms);
 
-			if(m_db)
+			m_busy_waiter.timeout = m_timeout;
+
+			// sqlite3_busy_timeout replaces the busy handler
+			if(m_db && !m_busy_handler)
 				sqlite3_busy_timeout(m_db, (int)m_timeout);
+
+			_set_progress_handler();
 		}
 
 		//@}
@@ -102,6 +108,9 @@ namespace zdb2
 		 */
 		virtual void close() override
 		{
+			// the cached statements must be finalized first,otherwise sqlite3_close returns SQLITE_BUSY
+			m_stmt_cache.clear();
+
 			if (m_db)
 			{
 				while (sqlite3_close(m_db) == SQLITE_BUSY)
@@ -111,6 +120,19 @@ namespace zdb2
 		}
 
 
+		/**
+		 * Cancel the SQL statement which is running on this Connection,it can
+		 * be called from another thread. The statement fails with SQLITE_INTERRUPT,
+		 * and if it writes in a transaction,SQLite rolls back the transaction.
+		 * @param C A Connection object
+		 */
+		virtual void cancel() override
+		{
+			if (m_db)
+				sqlite3_interrupt(m_db);
+		}
+
+
 		/**
 		 * Start a transaction. 
 		 * @param C A Connection object
@@ -139,7 +161,12 @@ namespace zdb2
 			{
 				if (connection::commit())
 				{
-					return (SQLITE_OK == _execute_sql("COMMIT TRANSACTION;"));
+					if (SQLITE_OK == _execute_sql("COMMIT TRANSACTION;"))
+					{
+						_on_commit();
+						return true;
+					}
+					return false;
 				}
 			}
 			return false;
@@ -161,6 +188,7 @@ namespace zdb2
 			{
 				if (connection::rollback())
 				{
+					_on_rollback();
 					return (SQLITE_OK == _execute_sql("ROLLBACK TRANSACTION;"));
 				}
 			}
@@ -211,20 +239,29 @@ namespace zdb2
 			if (!sql || sql[0] == '\0')
 				return false;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
-			
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
 
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
+
+			tracer * t = m_tracer.get();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
 			
-			return (_execute_sql(str.c_str()) == SQLITE_OK);
+			if (_execute_sql(str.c_str()) != SQLITE_OK)
+			{
+				if (t)
+					_trace_execute(*t, start, str.c_str(), true);
+				return false;
+			}
+
+			if (t)
+				_trace_execute(*t, start, str.c_str());
+
+			_on_write(str.c_str());
+			return true;
 		}
 
 		/**
@@ -246,39 +283,42 @@ namespace zdb2
 		 * @see ResultSet.h
 		 * @see SQLException.h
 		 */
-		virtual std::shared_ptr<resultset> query(const char *sql, ...)
+		virtual std::shared_ptr<resultset> query(const char *sql, ...) override
 		{
 			if (!sql || sql[0] == '\0')
 				return nullptr;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
 
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
+			std::shared_ptr<sqlite_resultset> rs = _vquery(sql, ap);
 
-			std::string str(len, '\0');
+			va_end(ap);
 
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			return rs;
+		}
 
-			va_end(ap);
+		/**
+		 * The same as query,but returns the sqlite resultset directly,so the calls on the 
+		 * resultset are not virtual and can be inlined into the caller's row loop.
+		 * @param C A Connection object
+		 * @param sql A SQL statement
+		 * @return A sqlite_resultset object that contains the data produced by the
+		 * given query. 
+		 */
+		std::shared_ptr<sqlite_resultset> execute_query(const char *sql, ...)
+		{
+			if (!sql || sql[0] == '\0')
+				return nullptr;
 
-			int status;
-			const char * tail;
-			sqlite3_stmt * stmt;
+			va_list ap;
+			va_start(ap, sql);
 
-#if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
-			status = sqlite_util::sqlite3_blocking_prepare_v2(m_db, str.c_str(), (int)str.length(), &stmt, &tail);
-#elif SQLITE_VERSION_NUMBER >= 3004000
-			status = sqlite_util::execute(m_timeout, sqlite3_prepare_v2, m_db, str.c_str(), (int)str.length(), &stmt, &tail);
-#else
-			status = sqlite_util::execute(m_timeout, sqlite3_prepare, m_db, str.c_str(), (int)str.length(), &stmt, &tail);
-#endif
-			if (status == SQLITE_OK)
-				return std::dynamic_pointer_cast<resultset>(std::make_shared<sqlite_resultset>(stmt,m_timeout));
+			std::shared_ptr<sqlite_resultset> rs = _vquery(sql, ap);
+
+			va_end(ap);
 
-			return nullptr;
+			return rs;
 		}
 
 		/**
@@ -305,20 +345,15 @@ namespace zdb2
 			if (!sql || sql[0] == '\0')
 				return nullptr;
 
-			va_list ap, ap_copy;
+			va_list ap;
 			va_start(ap, sql);
 
-			va_copy(ap_copy, ap);
-			int len = std::vsnprintf(nullptr, 0, sql, ap_copy);
-
-			std::string str(len, '\0');
-
-			va_copy(ap_copy, ap);
-			std::vsprintf((char*)str.data(), sql, ap_copy);
+			format_buffer str;
+			str.vformat(sql, ap);
 
 			va_end(ap);
 
-			return std::dynamic_pointer_cast<stmt>(std::make_shared<sqlite_stmt>(m_db,str.c_str(),m_timeout));
+			return _prepare_cached(str.c_str());
 		}
 
 
@@ -357,10 +392,58 @@ namespace zdb2
 		// @}
 
 	protected:
+		/**
+		 * the cached statement skips the parse and plan,and for the server databases a round trip.
+		 */
+		virtual std::shared_ptr<stmt> _prepare_cached(const char * sql) override
+		{
+			std::shared_ptr<stmt> s = m_stmt_cache.get(sql);
+			if (s)
+			{
+				s->reset();
+				return s;
+			}
+
+			s = _prepare_new(sql);
+			if (s->is_prepared())
+				m_stmt_cache.put(sql, s);
+
+			return s;
+		}
+
+		virtual std::shared_ptr<stmt> _prepare_new(const char * sql) override
+		{
+			tracer * t = m_tracer.get();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			std::shared_ptr<stmt> s = std::make_shared<sqlite_stmt>(m_db, sql, m_timeout, &m_busy_waiter);
+			if (s->is_prepared())
+			{
+				if (t)
+					_trace_prepare(*s, start);
+				_listen(*s);
+			}
+			else if (t)
+				_trace_execute(*t, start, sql, true);
+
+			return s;
+		}
+
 		virtual bool _init() override
 		{
 			if (!_connect())
 				return false;
+
+			// wait for the file locks inside the sqlite calls,instead of retrying the calls
+			std::string busy_handler = m_url_ptr->get_param_value("busy-handler");
+			if (busy_handler == "true" || busy_handler == "1")
+			{
+				m_busy_handler = true;
+				m_busy_waiter.timeout = m_timeout;
+				sqlite3_busy_handler(m_db, sqlite_util::busy_handler, &m_busy_waiter);
+			}
+
+			_set_progress_handler();
  
 			// There is no PRAGMA for heap limit as of sqlite-3.7.0, so we make it a configurable property using "heap_limit" [kB]
 			std::string heap_limit = m_url_ptr->get_param_value("heap_limit");
@@ -377,7 +460,7 @@ namespace zdb2
 			std::string params;
 			m_url_ptr->for_each_param([&params](std::pair<std::string, std::string> pair)
 			{
-				if (!pair.first.empty() && !pair.second.empty() && pair.first != "heap_limit")
+				if (!pair.first.empty() && !pair.second.empty() && !_is_pool_param(pair.first))
 				{
 					params += "PRAGMA ";
 					params += pair.first;
@@ -410,6 +493,18 @@ namespace zdb2
 				throw std::runtime_error("no database specified in url");
 				return false;
 			}
+			// "read-only=true" opens the database read only,it is used by the readers of sqlite_wal_pool
+			int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+			std::string read_only = m_url_ptr->get_param_value("read-only");
+			if (read_only == "true" || read_only == "1")
+				flags = SQLITE_OPEN_READONLY;
+
+			// "shared-cache=false" gives the connection its own page cache,the shared cache locks the
+			// tables and returns SQLITE_LOCKED to the other connections while one writes,in WAL mode the
+			// private caches let the readers run while the writer writes.
+			std::string shared_cache = m_url_ptr->get_param_value("shared-cache");
+			bool private_cache = (shared_cache == "false" || shared_cache == "0");
+
 			/* Shared cache mode help reduce database lock problems if libzdb is used with many threads */
 #if SQLITE_VERSION_NUMBER >= 3005000
 #ifndef DARWIN
@@ -421,9 +516,16 @@ namespace zdb2
 			holds as SQLite from 3.5 requires that both sqlite3_enable_shared_cache() _and_
 			sqlite3_open_v2(SQLITE_OPEN_SHAREDCACHE) is used to enable shared cache (!).
 			*/
-			sqlite3_enable_shared_cache(true);
+			if (!private_cache)
+				sqlite3_enable_shared_cache(true);
 #endif
-			status = sqlite3_open_v2(path.c_str(), &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_SHAREDCACHE, NULL);
+#if defined(SQLITE_OPEN_PRIVATECACHE)
+			flags |= (private_cache ? SQLITE_OPEN_PRIVATECACHE : SQLITE_OPEN_SHAREDCACHE);
+#else
+			if (!private_cache)
+				flags |= SQLITE_OPEN_SHAREDCACHE;
+#endif
+			status = sqlite3_open_v2(path.c_str(), &m_db, flags, NULL);
 #else
 			status = sqlite3_open(path.c_str(), &m_db);
 #endif
@@ -437,16 +539,93 @@ namespace zdb2
 		}
 
 
+		/**
+		 * the url parameters which are not sqlite pragmas
+		 */
+		static bool _is_pool_param(const std::string & name)
+		{
+			return (name == "heap_limit" || name == "warmup" || name == "warmup-threads" ||
+				name == "elastic" || name == "min-idle" || name == "elastic-interval" || name == "shards" ||
+				name == "stmt-cache" || name == "query-cache" || name == "query-cache-ttl" || name == "busy-handler" ||
+				name == "trace" || name == "slow-query" || name == "shared-cache" || name == "read-only" ||
+				name == "group-commit" || name == "group-commit-size");
+		}
+
+		std::shared_ptr<sqlite_resultset> _vquery(const char *sql, va_list ap)
+		{
+			format_buffer str;
+			str.vformat(sql, ap);
+
+			tracer * t = m_tracer.get();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			int status;
+			const char * tail;
+			sqlite3_stmt * stmt;
+
+#if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
+			status = sqlite_util::sqlite3_blocking_prepare_v2(m_db, str.c_str(), (int)str.length(), &stmt, &tail);
+#elif SQLITE_VERSION_NUMBER >= 3004000
+			status = sqlite_util::execute(m_timeout, &m_busy_waiter, sqlite3_prepare_v2, m_db, str.c_str(), (int)str.length(), &stmt, &tail);
+#else
+			status = sqlite_util::execute(m_timeout, &m_busy_waiter, sqlite3_prepare, m_db, str.c_str(), (int)str.length(), &stmt, &tail);
+#endif
+			if (status != SQLITE_OK)
+			{
+				if (t)
+					_trace_execute(*t, start, str.c_str(), true);
+				return nullptr;
+			}
+
+			std::shared_ptr<sqlite_resultset> rs = std::make_shared<sqlite_resultset>(stmt, m_timeout, &m_busy_waiter);
+
+			// the statement is run by the first step,which is a part of the fetch
+			if (t)
+				_trace_query(*t, start, std::chrono::steady_clock::now(), str.c_str(), *rs);
+
+			return rs;
+		}
+
+		/**
+		 * interrupt the statements running longer than the query timeout,see sqlite_util::progress_handler.
+		 */
+		void _set_progress_handler()
+		{
+			if (!m_db)
+				return;
+
+			if (m_timeout > 0)
+				sqlite3_progress_handler(m_db, zdb2::DEFAULT_PROGRESS_INTERVAL, sqlite_util::progress_handler, &m_timeout);
+			else
+				sqlite3_progress_handler(m_db, 0, nullptr, nullptr);
+		}
+
+		/**
+		 * the transaction is rolled back by SQLite when a statement of it is interrupted,and a transaction
+		 * may be started by execute("BEGIN") without begin_transaction.
+		 */
+		virtual void _reset() override
+		{
+			connection::_reset();
+
+			if (m_db && !sqlite3_get_autocommit(m_db))
+				_execute_sql("ROLLBACK TRANSACTION;");
+		}
+
 		int _execute_sql(const char * sql)
 		{
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
 			return sqlite_util::sqlite3_blocking_exec(m_db, sql, nullptr, nullptr, nullptr);
 #else
-			return sqlite_util::execute(m_timeout, sqlite3_exec, m_db, sql, nullptr, nullptr, nullptr);
+			return sqlite_util::execute(m_timeout, &m_busy_waiter, sqlite3_exec, m_db, sql, nullptr, nullptr, nullptr);
 #endif
 		}
 
 		sqlite3 * m_db = nullptr;
+
+		/// the sqlite3_busy_handler is used instead of retrying the calls,see sqlite_util::busy_handler
+		bool m_busy_handler = false;
+		sqlite_util::busy_waiter m_busy_waiter;
 	};
 
 }
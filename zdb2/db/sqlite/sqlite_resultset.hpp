@@ -22,6 +22,7 @@
 #include <sqlite3.h>
 
 #include <zdb2/db/resultset.hpp>
+#include <zdb2/db/stmt.hpp>
 #include <zdb2/db/sqlite/sqlite_util.hpp>
 
 namespace zdb2
@@ -29,15 +30,39 @@ namespace zdb2
 
 #pragma warning(disable:4996)
 
-	class sqlite_resultset : public resultset
+	class sqlite_resultset final : public resultset
 	{
 	public:
 		sqlite_resultset(
 			sqlite3_stmt * stmt,
-			std::size_t timeout = zdb2::DEFAULT_TIMEOUT
+			std::size_t timeout = zdb2::DEFAULT_TIMEOUT,
+			sqlite_util::busy_waiter * waiter = nullptr
 		)
 			: resultset(timeout)
 			, m_stmt(stmt)
+			, m_busy_waiter(waiter)
+		{
+			assert(m_stmt);
+			if (!m_stmt)
+				throw std::runtime_error("invalid parameters.");
+
+			_init();
+		}
+
+		/**
+		 * the resultset of a prepared statement,the statement is not finalized with the resultset,
+		 * the owner keeps the statement alive while the resultset is used.
+		 */
+		sqlite_resultset(
+			sqlite3_stmt * stmt,
+			std::size_t timeout,
+			std::shared_ptr<zdb2::stmt> owner,
+			sqlite_util::busy_waiter * waiter = nullptr
+		)
+			: resultset(timeout)
+			, m_stmt(stmt)
+			, m_owner(owner)
+			, m_busy_waiter(waiter)
 		{
 			assert(m_stmt);
 			if (!m_stmt)
@@ -53,10 +78,16 @@ namespace zdb2
 
 		virtual void close() override
 		{
+			_trace_finish();
+
 			if (m_stmt)
 			{
-				sqlite3_finalize(m_stmt);
+				if (m_owner)
+					sqlite3_reset(m_stmt);
+				else
+					sqlite3_finalize(m_stmt);
 				m_stmt = nullptr;
+				m_owner.reset();
 			}
 		}
 		
@@ -85,14 +116,45 @@ namespace zdb2
 		}
 
 		/**
-		 * @function : get column index by column name
+		 * Returns the type the values of the designated column are best read as,
+		 * by the type affinity rules of sqlite on the declared type of the column
+		 * (see https://www.sqlite.org/datatype3.html),or by the storage class of 
+		 * the current row if the column is a expression.
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @return The column type
 		 */
-		virtual int get_column_index(const char * column_name) override
+		virtual column_type get_column_type(int column_index) override
 		{
-			auto iterator = m_column_name_map.find(column_name);
-			if (iterator != m_column_name_map.end())
-				return iterator->second;
-			return -1;
+			if (!m_stmt)
+				return column_type::text;
+
+			const char * decl = sqlite3_column_decltype(m_stmt, column_index);
+			if (!decl)
+			{
+				switch (sqlite3_column_type(m_stmt, column_index))
+				{
+				case SQLITE_INTEGER: return column_type::int64;
+				case SQLITE_FLOAT:   return column_type::real;
+				case SQLITE_BLOB:    return column_type::blob;
+				default:             return column_type::text;
+				}
+			}
+
+			std::string type(decl);
+			std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+
+			if (type.find("INT") != std::string::npos)
+				return column_type::int64;
+			if (type.find("CHAR") != std::string::npos || type.find("CLOB") != std::string::npos || type.find("TEXT") != std::string::npos)
+				return column_type::text;
+			if (type.empty() || type.find("BLOB") != std::string::npos)
+				return column_type::blob;
+			if (type.find("REAL") != std::string::npos || type.find("FLOA") != std::string::npos || type.find("DOUB") != std::string::npos)
+				return column_type::real;
+
+			// NUMERIC affinity,the dates and decimals are often stored as text
+			return column_type::text;
 		}
 
 		/**
@@ -131,19 +193,132 @@ namespace zdb2
 			if (!m_stmt)
 				return false;
 
+			auto start = (m_tracer ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			sqlite_util::deadline_scope scope(m_deadline);
+
 			int status;
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
 			status = sqlite_util::sqlite3_blocking_step(m_stmt);
 #else
-			status = sqlite_util::execute(m_timeout, sqlite3_step, m_stmt);
+			status = sqlite_util::execute(m_timeout, m_busy_waiter, sqlite3_step, m_stmt);
 #endif
 			if (status != SQLITE_ROW && status != SQLITE_DONE)
 			{
-				throw std::runtime_error("not desired return value of sqlite3_step.");
+				if (m_tracer)
+					_trace_error(start);
+				throw std::runtime_error(sqlite3_errmsg(sqlite3_db_handle(m_stmt)));
+			}
+
+			if (m_tracer)
+			{
+				if (status == SQLITE_ROW)
+					_trace_fetch(start, 1, _row_bytes());
+				else
+				{
+					_trace_fetch(start, 0, 0);
+					_trace_finish();
+				}
 			}
 			return (status == SQLITE_ROW);
 		}
 
+
+		/**
+		 * Moves the cursor down up to <code>n</code> rows and appends the values
+		 * of every row to the column buffers,see resultset::fetch_batch. The rows 
+		 * are stepped and read by the sqlite3 api directly.
+		 * @param R A ResultSet object
+		 * @param n The maximum number of rows to fetch
+		 * @param columns The column buffers
+		 * @return The number of rows fetched,0 if there are no more rows
+		 * @exception SQLException If a database access error occurs
+		 */
+		virtual std::size_t fetch_batch(std::size_t n, std::vector<column_buffer> & columns) override
+		{
+			for (auto & column : columns)
+				column.clear();
+
+			if (!m_stmt)
+				return 0;
+
+			int count = std::min((int)columns.size(), sqlite3_column_count(m_stmt));
+
+			auto start = (m_tracer ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+			std::size_t bytes = 0;
+			bool done = false;
+
+			sqlite_util::deadline_scope scope(m_deadline);
+
+			std::size_t rows = 0;
+			while (rows < n)
+			{
+				int status;
+#if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
+				status = sqlite_util::sqlite3_blocking_step(m_stmt);
+#else
+				status = sqlite_util::execute(m_timeout, m_busy_waiter, sqlite3_step, m_stmt);
+#endif
+				if (status == SQLITE_DONE)
+				{
+					done = true;
+					break;
+				}
+				if (status != SQLITE_ROW)
+				{
+					if (m_tracer)
+						_trace_error(start);
+					throw std::runtime_error(sqlite3_errmsg(sqlite3_db_handle(m_stmt)));
+				}
+
+				if (m_tracer)
+					bytes += _row_bytes();
+
+				for (int i = 0; i < count; i++)
+				{
+					column_buffer & column = columns[i];
+
+					if (sqlite3_column_type(m_stmt, i) == SQLITE_NULL)
+					{
+						column.push_null();
+						continue;
+					}
+
+					switch (column.get_type())
+					{
+					case column_type::int64:
+						column.push_int64(sqlite3_column_int64(m_stmt, i));
+						break;
+					case column_type::real:
+						column.push_double(sqlite3_column_double(m_stmt, i));
+						break;
+					case column_type::text:
+						{
+							// sqlite3_column_bytes must be called after the conversion to text
+							const unsigned char * text = sqlite3_column_text(m_stmt, i);
+							column.push_bytes(text, (std::size_t)sqlite3_column_bytes(m_stmt, i));
+						}
+						break;
+					case column_type::blob:
+						{
+							const void * blob = sqlite3_column_blob(m_stmt, i);
+							column.push_bytes(blob, (std::size_t)sqlite3_column_bytes(m_stmt, i));
+						}
+						break;
+					}
+				}
+				rows++;
+			}
+
+			if (m_tracer)
+			{
+				_trace_fetch(start, rows, bytes);
+				if (done)
+					_trace_finish();
+			}
+			return rows;
+		}
+
 		/** @name Columns */
 		//@{
 
@@ -364,10 +539,13 @@ namespace zdb2
 		 */
 		virtual const void * get_blob(int column_index, std::size_t * size) override
 		{
+			if (size)
+				*size = 0;
 			if (!m_stmt)
 				return nullptr;
 			const void * blob = sqlite3_column_blob(m_stmt, column_index);
-			*size = sqlite3_column_bytes(m_stmt, column_index);
+			if (size)
+				*size = sqlite3_column_bytes(m_stmt, column_index);
 			return blob;
 		}
 
@@ -390,9 +568,38 @@ namespace zdb2
 		virtual const void * get_blob(const char * column_name, std::size_t * size) override
 		{
 			int col_index = get_column_index(column_name);
+			if (col_index < 0 && size)
+				*size = 0;
 			return ((col_index >= 0) ? get_blob(col_index, size) : nullptr);
 		}
 
+
+		/**
+		 * Retrieves the value of the designated column in the current row of
+		 * this ResultSet object as a pointer to the text and its length,see 
+		 * resultset::get_text. The text is the sqlite3_column_text buffer,it 
+		 * is valid until the next call to next_row() or close().
+		 * @param R A ResultSet object
+		 * @param columnIndex The first column is 1, the second is 2, ...
+		 * @param size The number of bytes in the text is stored in size 
+		 * @return The column value; if the value is SQL NULL, the value
+		 * returned is NULL and the size is 0
+		 */
+		virtual const char * get_text(int column_index, std::size_t * size) override
+		{
+			if (size)
+				*size = 0;
+			if (!m_stmt)
+				return nullptr;
+			// sqlite3_column_bytes must be called after the conversion to text
+			const char * text = (const char *)sqlite3_column_text(m_stmt, column_index);
+			if (text && size)
+				*size = sqlite3_column_bytes(m_stmt, column_index);
+			return text;
+		}
+
+		using resultset::get_text;
+
 		//@}
 
 		/** @name Date and Time  */
@@ -428,10 +635,18 @@ namespace zdb2
 		{
 			if (!m_stmt)
 				return (time_t)0;
-			if (sqlite3_column_type(m_stmt, column_index) == SQLITE_INTEGER)
+			switch (sqlite3_column_type(m_stmt, column_index))
+			{
+			case SQLITE_INTEGER:
 				return (time_t)sqlite3_column_int64(m_stmt, column_index);
-			// Not integer storage class, try to parse as time string
-			return (time_t)0;
+			case SQLITE_FLOAT:
+				return (time_t)sqlite3_column_double(m_stmt, column_index);
+			case SQLITE_NULL:
+				return (time_t)0;
+			default:
+				// Not integer storage class, parse as time string
+				return datetime_parser::to_timestamp(_parse_text_datetime(column_index));
+			}
 		}
 
 
@@ -501,20 +716,18 @@ namespace zdb2
 			struct tm tm = { 0 };
 			if (!m_stmt)
 				return tm;
-			if (sqlite3_column_type(m_stmt, column_index) == SQLITE_INTEGER)
+			switch (sqlite3_column_type(m_stmt, column_index))
 			{
-				time_t utc = (time_t)sqlite3_column_int64(m_stmt, column_index);
-				struct tm * utc_tm = std::gmtime(&utc);
-				if (utc_tm)
-					utc_tm->tm_year += 1900; // Use year literal
-				return (*utc_tm);
-			}
-			else
-			{
-				// Not integer storage class, try to parse as time string
-
+			case SQLITE_INTEGER:
+			case SQLITE_FLOAT:
+				// the year literal is used,see datetime_parser::to_tm
+				return datetime_parser::to_tm(datetime_parser::from_timestamp(get_timestamp(column_index)));
+			case SQLITE_NULL:
+				return tm;
+			default:
+				// Not integer storage class, parse as time string
+				return datetime_parser::to_tm(_parse_text_datetime(column_index));
 			}
-			return tm;
 		}
 
 
@@ -556,23 +769,69 @@ namespace zdb2
 	protected:
 		virtual void _init() override
 		{
-			if (m_stmt)
+		}
+
+		/// the bytes of the values of the current row,the numbers are not converted to text for it
+		std::size_t _row_bytes()
+		{
+			std::size_t bytes = 0;
+			int count = sqlite3_column_count(m_stmt);
+			for (int i = 0; i < count; i++)
 			{
-				int cols = get_column_count();
-				for (int col = 0; col < cols; col++)
+				switch (sqlite3_column_type(m_stmt, i))
 				{
-					std::string col_name(get_column_name(col));
-					m_column_name_map.emplace(col_name, col);
+				case SQLITE_INTEGER:
+				case SQLITE_FLOAT:
+					bytes += 8;
+					break;
+				case SQLITE_TEXT:
+				case SQLITE_BLOB:
+					bytes += (std::size_t)sqlite3_column_bytes(m_stmt, i);
+					break;
+				default:
+					break;
 				}
 			}
+			return bytes;
 		}
 
+		/**
+		 * parse the TEXT of a column as a date,time or date and time.SQLite has no date or time type,and
+		 * the Unix times are often stored as TEXT,so the text of a integer (eg : "1700000000") is read as
+		 * seconds since the epoch,the other text is parsed by _parse_datetime.
+		 */
+		datetime_value _parse_text_datetime(int column_index)
+		{
+			const char * s = (const char *)sqlite3_column_text(m_stmt, column_index);
+			std::size_t size = (std::size_t)sqlite3_column_bytes(m_stmt, column_index);
+			if (!s || size == 0)
+				return datetime_value();
+
+			std::size_t i = ((s[0] == '-' || s[0] == '+') ? 1 : 0);
+			if (i < size && size - i <= 18)
+			{
+				std::int64_t seconds = 0;
+				for (; i < size && (unsigned char)(s[i] - '0') <= 9; i++)
+					seconds = seconds * 10 + (s[i] - '0');
+				if (i == size)
+					return datetime_parser::from_timestamp((time_t)(s[0] == '-' ? -seconds : seconds));
+			}
+
+			return _parse_datetime(s, size);
+		}
 
 	protected:
 
 		sqlite3_stmt * m_stmt = nullptr;
 
-		std::unordered_map<std::string, int> m_column_name_map;
+		/// the prepared statement which owns the m_stmt,empty if the m_stmt is owned by this resultset
+		std::shared_ptr<zdb2::stmt> m_owner;
+
+		/// the busy handler state of the connection,see sqlite_util::execute
+		sqlite_util::busy_waiter * m_busy_waiter = nullptr;
+
+		/// all the steps of the resultset are one execution of the statement,see sqlite_util::progress_handler
+		sqlite_util::deadline_t m_deadline;
 
 	};
 
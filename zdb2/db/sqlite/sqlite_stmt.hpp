@@ -20,20 +20,23 @@
 
 #include <zdb2/db/stmt.hpp>
 #include <zdb2/db/sqlite/sqlite_util.hpp>
+#include <zdb2/db/sqlite/sqlite_resultset.hpp>
 
 namespace zdb2
 {
 
-	class sqlite_stmt : public stmt
+	class sqlite_stmt final : public stmt
 	{
 	public:
 		sqlite_stmt(
 			sqlite3 * db,
 			const char * sql,
-			std::size_t timeout
+			std::size_t timeout,
+			sqlite_util::busy_waiter * waiter = nullptr
 		)
 			: stmt(sql,timeout)
 			, m_db(db)
+			, m_busy_waiter(waiter)
 		{
 			if (!m_db)
 				throw std::runtime_error("invalid parameters.");
@@ -55,6 +58,24 @@ namespace zdb2
 			}
 		}
 
+		/**
+		 * Reset the statement to its initial state and clear all the parameters.
+		 * @param P A PreparedStatement object
+		 */
+		virtual void reset() override
+		{
+			if (m_stmt)
+			{
+				sqlite3_reset(m_stmt);
+				sqlite3_clear_bindings(m_stmt);
+			}
+		}
+
+		virtual bool is_prepared() override
+		{
+			return (m_stmt != nullptr);
+		}
+
 		/** @name Parameters */
 		//@{
 
@@ -75,7 +96,7 @@ namespace zdb2
 			{
 				sqlite3_reset(m_stmt);
 				int size = x ? (int)std::strlen(x) : 0;
-				if (SQLITE_RANGE == sqlite3_bind_text(m_stmt, param_index, x, size, SQLITE_STATIC))
+				if (SQLITE_RANGE == sqlite3_bind_text(m_stmt, param_index, x, size, (m_copy_params ? SQLITE_TRANSIENT : SQLITE_STATIC)))
 					throw std::runtime_error("parameter index is out of range.");
 			}
 		}
@@ -172,7 +193,7 @@ namespace zdb2
 			if (m_stmt)
 			{
 				sqlite3_reset(m_stmt);
-				if (SQLITE_RANGE == sqlite3_bind_blob(m_stmt, param_index, x, (int)size, SQLITE_STATIC))
+				if (SQLITE_RANGE == sqlite3_bind_blob(m_stmt, param_index, x, (int)size, (m_copy_params ? SQLITE_TRANSIENT : SQLITE_STATIC)))
 					throw std::runtime_error("parameter index is out of range.");
 			}
 		}
@@ -216,29 +237,74 @@ namespace zdb2
 		 */
 		virtual void execute() override
 		{
-			int status = 0;
-#if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
-			status = sqlite_util::sqlite3_blocking_step(m_stmt);
-#else
-			status = sqlite_util::execute(m_timeout, sqlite3_step, m_stmt);
-#endif
+			tracer * t = _tracer();
+			auto start = (t ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point());
+
+			// a new execution,the retry after the statement is compiled again is a part of it
+			m_deadline.reset();
+			sqlite_util::deadline_scope scope(m_deadline);
+
+			int status = _step();
+
+			// the schema is changed since the statement is compiled (the statement may be cached for
+			// a long time),sqlite3_prepare_v2 statements recompile by themselves,but give up after 
+			// several retries,and the legacy statements report it by sqlite3_reset,so compile it again.
+			if (status != SQLITE_DONE && status != SQLITE_ROW)
+			{
+				int reset_status = sqlite3_reset(m_stmt);
+				if ((status == SQLITE_SCHEMA || reset_status == SQLITE_SCHEMA) && _reprepare())
+					status = _step();
+			}
+
 			switch (status)
 			{
 			case SQLITE_DONE:
 				status = sqlite3_reset(m_stmt);
+				if (t)
+					_trace_execute(*t, start);
+				_executed();
 				break;
 			case SQLITE_ROW:
 				status = sqlite3_reset(m_stmt);
+				if (t)
+					_trace_execute(*t, start, true);
 				throw std::runtime_error("select statement not allowed in execute().");
 				break;
 			default:
 				status = sqlite3_reset(m_stmt);
+				if (t)
+					_trace_execute(*t, start, true);
 				throw std::runtime_error(sqlite3_errmsg(m_db));
 				break;
 			}
 		}
 
 
+		/**
+		 * Executes the prepared SQL statement,which returns a single ResultSet object.
+		 * The ResultSet uses this statement,it "lives" only until the statement is 
+		 * executed again or closed.
+		 * @param P A PreparedStatement object
+		 * @return A ResultSet object that contains the data produced by the prepared
+		 * statement.
+		 * @exception SQLException If a database error occurs
+		 */
+		virtual std::shared_ptr<resultset> query() override
+		{
+			if (!m_stmt)
+				throw std::runtime_error(sqlite3_errmsg(m_db));
+
+			std::shared_ptr<sqlite_resultset> rs = std::make_shared<sqlite_resultset>(m_stmt, m_timeout, shared_from_this(), m_busy_waiter);
+
+			// the statement is run by the first step,which is a part of the fetch
+			tracer * t = _tracer();
+			if (t)
+				_trace_query(*t, std::chrono::steady_clock::now(), *rs);
+
+			return rs;
+		}
+
+
 		/**
 		 * Returns the number of rows that was inserted, deleted or modified by the
 		 * most recently completed SQL statement on the database connection. If used
@@ -253,6 +319,29 @@ namespace zdb2
 		}
 
 
+		/**
+		 * Returns the sql text with the values of the parameters in place of the
+		 * placeholders,by sqlite3_expanded_sql of SQLite 3.14 and later.
+		 * @param P A PreparedStatement object
+		 */
+		virtual std::string get_expanded_sql() override
+		{
+#if SQLITE_VERSION_NUMBER >= 3014000
+			if (m_stmt)
+			{
+				char * sql = sqlite3_expanded_sql(m_stmt);
+				if (sql)
+				{
+					std::string s(sql);
+					sqlite3_free(sql);
+					return s;
+				}
+			}
+#endif
+			return m_sql;
+		}
+
+
 		/** @name Properties */
 		//@{
 
@@ -261,6 +350,43 @@ namespace zdb2
 
 
 	protected:
+		int _step()
+		{
+#if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
+			return sqlite_util::sqlite3_blocking_step(m_stmt);
+#else
+			return sqlite_util::execute(m_timeout, m_busy_waiter, sqlite3_step, m_stmt);
+#endif
+		}
+
+		/**
+		 * compile the sql again and move the parameters to the new statement.
+		 */
+		bool _reprepare()
+		{
+#if defined(SQLITE_OMIT_DEPRECATED)
+			// the parameters can't be moved without sqlite3_transfer_bindings
+			return false;
+#endif
+			sqlite3_stmt * old_stmt = m_stmt;
+
+			m_stmt = nullptr;
+			_init();
+
+			if (!m_stmt)
+			{
+				m_stmt = old_stmt;
+				return false;
+			}
+
+#if !defined(SQLITE_OMIT_DEPRECATED)
+			sqlite3_transfer_bindings(old_stmt, m_stmt);
+#endif
+			sqlite3_finalize(old_stmt);
+
+			return true;
+		}
+
 		virtual void _init() override
 		{
 			if (m_db && !m_sql.empty())
@@ -271,9 +397,9 @@ namespace zdb2
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
 				status = sqlite_util::sqlite3_blocking_prepare_v2(m_db, m_sql.c_str(), -1, &m_stmt, &tail);
 #elif SQLITE_VERSION_NUMBER >= 3004000
-				status = sqlite_util::execute(m_timeout, sqlite3_prepare_v2, m_db, m_sql.c_str(), -1, &m_stmt, &tail);
+				status = sqlite_util::execute(m_timeout, m_busy_waiter, sqlite3_prepare_v2, m_db, m_sql.c_str(), -1, &m_stmt, &tail);
 #else
-				status = sqlite_util::execute(m_timeout, sqlite3_prepare, m_db, m_sql.c_str(), -1, &m_stmt, &tail);
+				status = sqlite_util::execute(m_timeout, m_busy_waiter, sqlite3_prepare, m_db, m_sql.c_str(), -1, &m_stmt, &tail);
 #endif
 
 				if (status == SQLITE_OK)
@@ -288,6 +414,12 @@ namespace zdb2
 
 		sqlite3_stmt * m_stmt = nullptr;
 
+		/// the busy handler state of the connection,see sqlite_util::execute
+		sqlite_util::busy_waiter * m_busy_waiter = nullptr;
+
+		/// the deadline of the running execute,see sqlite_util::progress_handler
+		sqlite_util::deadline_t m_deadline;
+
 	};
 
 }
@@ -11,22 +11,165 @@
 #pragma once
 
 #include <cctype>
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <algorithm>
 #include <mutex>
 #include <thread>
+#include <chrono>
+#include <random>
+#include <functional>
 #include <condition_variable>
 
 #include <sqlite3.h>
 
+#include <zdb2/config.hpp>
+#include <zdb2/util/striped_counter.hpp>
+
 namespace zdb2
 {
 
+	/**
+	 * the statistics of the waits for the SQLite locks and the query timeouts of all the connections,see 
+	 * sqlite_util::get_busy_stats.
+	 */
+	struct sqlite_busy_stats
+	{
+		/// count of the calls retried after SQLITE_BUSY or SQLITE_LOCKED
+		std::uint64_t retries = 0;
+
+		/// count of the calls which were still blocked when the query timeout was reached
+		std::uint64_t timeouts = 0;
+
+		/// total time slept waiting for the locks in microseconds
+		std::uint64_t wait_time = 0;
+
+		/// count of the statements interrupted by the query timeout,see sqlite_util::progress_handler
+		std::uint64_t interrupts = 0;
+	};
+
 	class sqlite_util
 	{
 	public:
 
+		/**
+		 * the state of the busy handler of a connection,see busy_handler.
+		 */
+		struct busy_waiter
+		{
+			/// the query timeout in milliseconds,zero means there is no limit
+			std::size_t timeout = zdb2::DEFAULT_TIMEOUT;
+
+			/// when the current wait began
+			std::chrono::steady_clock::time_point start;
+
+			/// the handler gave up the last wait,so execute don't retry the call,see execute
+			bool gave_up = false;
+		};
+
+		/**
+		 * Returns the waits for the locks of all the connections since the program started.
+		 */
+		static sqlite_busy_stats get_busy_stats()
+		{
+			sqlite_busy_stats s;
+			s.retries   = _counters().retries.load();
+			s.timeouts  = _counters().timeouts.load();
+			s.wait_time = _counters().wait_time.load();
+			s.interrupts = _counters().interrupts.load();
+			return s;
+		}
+
+		/**
+		 * Returns the sleep before the retry,it doubles every attempt from DEFAULT_BUSY_BACKOFF_MIN up to 
+		 * DEFAULT_BUSY_BACKOFF_MAX,and a random part of it is cut off,so the connections waiting for the
+		 * same lock don't wake up at the same time.
+		 * @param attempt The first attempt is 0
+		 */
+		static std::chrono::microseconds backoff(std::size_t attempt)
+		{
+			std::size_t delay = zdb2::DEFAULT_BUSY_BACKOFF_MAX;
+			if (attempt < 32 && (zdb2::DEFAULT_BUSY_BACKOFF_MIN << attempt) < zdb2::DEFAULT_BUSY_BACKOFF_MAX)
+				delay = zdb2::DEFAULT_BUSY_BACKOFF_MIN << attempt;
+
+			static thread_local std::minstd_rand random((unsigned int)(
+				std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+				(std::size_t)std::chrono::steady_clock::now().time_since_epoch().count()));
+
+			// sleep between the half and the whole of the delay
+			delay = delay / 2 + random() % (delay / 2 + 1);
+
+			return std::chrono::microseconds(delay);
+		}
+
+		/**
+		 * the sqlite3_busy_handler callback which sleeps with the same backoff as execute until the query
+		 * timeout,enabled by the url parameter "busy-handler=true".SQLite calls it while it waits for a 
+		 * file lock inside the call,so the statement don't need to be run again,the SQLITE_LOCKED of the
+		 * shared cache is not handled by it,and is retried by execute.
+		 * @param arg The busy_waiter of the connection
+		 * @param count The number of times the handler was called for the same lock
+		 * @return zero to give up and return SQLITE_BUSY
+		 */
+		static int busy_handler(void * arg, int count)
+		{
+			busy_waiter * waiter = (busy_waiter *)arg;
+
+			auto now = std::chrono::steady_clock::now();
+			if (count == 0)
+			{
+				waiter->start = now;
+				waiter->gave_up = false;
+			}
+
+			std::chrono::microseconds delay = backoff((std::size_t)count);
+			if (waiter->timeout > 0)
+			{
+				auto deadline = waiter->start + std::chrono::milliseconds(waiter->timeout);
+				if (now >= deadline)
+				{
+					_counters().timeouts.add();
+					waiter->gave_up = true;
+					return 0;
+				}
+				delay = (std::min)(delay, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now));
+			}
+
+			_sleep(delay);
+			return 1;
+		}
+
+		/**
+		 * the sqlite3_progress_handler callback which interrupts a statement running longer than the query
+		 * timeout,it is called every DEFAULT_PROGRESS_INTERVAL virtual machine instructions in the thread
+		 * which runs the statement.The deadline starts at the first callback of a statement execution,
+		 * all the steps of a resultset share the deadline of it,see deadline_scope,the other sqlite calls
+		 * get a deadline each.The executions which are shorter than the interval never read the clock.
+		 * @param arg The query timeout in milliseconds of the connection
+		 * @return non-zero to interrupt the statement,it fails with SQLITE_INTERRUPT
+		 */
+		static int progress_handler(void * arg)
+		{
+			std::size_t timeout = *(const std::size_t *)arg;
+			if (timeout == 0)
+				return 0;
+
+			deadline_t & d = (_scope() ? *_scope() : _deadline());
+			auto now = std::chrono::steady_clock::now();
+			if (!d.armed)
+			{
+				d.armed = true;
+				d.start = now;
+			}
+
+			if (d.spent + (now - d.start) < std::chrono::milliseconds(timeout))
+				return 0;
+
+			_counters().interrupts.add();
+			return 1;
+		}
+
 #if defined SQLITEUNLOCK && SQLITE_VERSION_NUMBER >= 3006012
 
 		/* SQLite unlock notify based synchronization */
@@ -69,6 +212,7 @@ namespace zdb2
 		static inline int sqlite3_blocking_step(sqlite3_stmt *stmt)
 		{
 			int rc;
+			_deadline().armed = false;
 			while (SQLITE_LOCKED == (rc = sqlite3_step(stmt)))
 			{
 				rc = wait_for_unlock_notify(sqlite3_db_handle(stmt));
@@ -82,6 +226,7 @@ namespace zdb2
 		static inline int sqlite3_blocking_prepare_v2(sqlite3 *db, const char *zSql, int nSql, sqlite3_stmt **stmt, const char **pz)
 		{
 			int rc;
+			_deadline().armed = false;
 			while (SQLITE_LOCKED == (rc = sqlite3_prepare_v2(db, zSql, nSql, stmt, pz)))
 			{
 				rc = wait_for_unlock_notify(db);
@@ -94,6 +239,7 @@ namespace zdb2
 		static inline int sqlite3_blocking_exec(sqlite3 *db, const char *zSql, int(*callback)(void *, int, char **, char **), void *arg, char **errmsg)
 		{
 			int rc;
+			_deadline().armed = false;
 			while (SQLITE_LOCKED == (rc = sqlite3_exec(db, zSql, callback, arg, errmsg)))
 			{
 				rc = wait_for_unlock_notify(db);
@@ -106,25 +252,157 @@ namespace zdb2
 #else
 		/* SQLite timed retry macro */
 
+		/**
+		 * call the sqlite function,and retry it with an exponential backoff while it returns SQLITE_BUSY
+		 * or SQLITE_LOCKED until the timeout is reached.
+		 * @param timeout The query timeout in milliseconds,zero means there is no limit
+		 * @param waiter The busy_waiter of the connection,nullptr if the busy handler is not used
+		 */
 		template<typename _handler, typename... Args>
-		static inline int execute(std::size_t timeout, _handler handler, Args... handler_args)
+		static inline int execute(std::size_t timeout, busy_waiter * waiter, _handler handler, Args... handler_args)
 		{
-			int status = 0;
-			int x = 0;
-			while (true)
-			{
-				status = handler(handler_args...);
+			// a new call,the statement executions use the deadline of their scope,see progress_handler
+			_deadline().armed = false;
+
+			// the flag may be left by a call which is not made by execute,eg : sqlite3_finalize
+			if (waiter)
+				waiter->gave_up = false;
+
+			int status = handler(handler_args...);
+			if (!_is_busy(status))
+				return status;
 
-				if (((status == SQLITE_BUSY) || (status == SQLITE_LOCKED)) && (x++ <= 9))
-					std::this_thread::sleep_for(std::chrono::milliseconds(timeout / 100));
-				else
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+			for (std::size_t attempt = 0; _is_busy(status); attempt++)
+			{
+				// the busy handler of the connection has waited until the timeout already
+				if (status == SQLITE_BUSY && waiter && waiter->gave_up)
+				{
+					waiter->gave_up = false;
 					break;
+				}
+
+				std::chrono::microseconds delay = backoff(attempt);
+				if (timeout > 0)
+				{
+					auto now = std::chrono::steady_clock::now();
+					if (now >= deadline)
+					{
+						_counters().timeouts.add();
+						break;
+					}
+					delay = (std::min)(delay, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now));
+				}
+
+				_sleep(delay);
+
+				status = handler(handler_args...);
 			}
 			return status;
 		}
 
 #endif
 
+		/// the time a statement execution has run,see progress_handler
+		struct deadline_t
+		{
+			/// a new execution
+			void reset()
+			{
+				armed = false;
+				spent = std::chrono::steady_clock::duration::zero();
+			}
+
+			/// the running sqlite call is measured since start
+			bool armed = false;
+			std::chrono::steady_clock::time_point start;
+
+			/// the time of the sqlite calls of the execution which are done
+			std::chrono::steady_clock::duration spent = std::chrono::steady_clock::duration::zero();
+		};
+
+		/**
+		 * the sqlite calls made while it is alive are a part of the statement execution which owns the
+		 * deadline,so a execution made of many steps is interrupted when the time of all its steps
+		 * together reaches the query timeout,the time of the caller between the steps is not counted.
+		 */
+		class deadline_scope
+		{
+		public:
+			explicit deadline_scope(deadline_t & d) : m_prev(_scope())
+			{
+				_scope() = &d;
+			}
+
+			~deadline_scope()
+			{
+				deadline_t * d = _scope();
+				if (d->armed)
+				{
+					d->armed = false;
+					d->spent += std::chrono::steady_clock::now() - d->start;
+				}
+				_scope() = m_prev;
+			}
+
+		private:
+			/// no copy construct function
+			deadline_scope(const deadline_scope&) = delete;
+
+			/// no operator equal function
+			deadline_scope& operator=(const deadline_scope&) = delete;
+
+		protected:
+			deadline_t * m_prev = nullptr;
+		};
+
+	protected:
+
+		struct counters
+		{
+			striped_counter<> retries;
+			striped_counter<> timeouts;
+			striped_counter<> wait_time;
+			striped_counter<> interrupts;
+		};
+
+		/// the deadline of the sqlite call running in this thread out of a deadline_scope
+		static deadline_t & _deadline()
+		{
+			static thread_local deadline_t d;
+			return d;
+		}
+
+		/// the deadline of the statement execution running in this thread,see deadline_scope
+		static deadline_t *& _scope()
+		{
+			static thread_local deadline_t * d = nullptr;
+			return d;
+		}
+
+		static counters & _counters()
+		{
+			static counters c;
+			return c;
+		}
+
+		static inline bool _is_busy(int status)
+		{
+			return (status == SQLITE_BUSY || status == SQLITE_LOCKED);
+		}
+
+		/// sleep before a retry,and count the retry and the time really slept
+		static void _sleep(std::chrono::microseconds delay)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			std::this_thread::sleep_for(delay);
+
+			_counters().retries.add();
+			_counters().wait_time.add((std::uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start).count());
+		}
 
 	};
 
@@ -0,0 +1,379 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <initializer_list>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+#include <zdb2/config.hpp>
+#include <zdb2/net/url.hpp>
+#include <zdb2/db/basic_pool.hpp>
+#include <zdb2/db/stored_args.hpp>
+#include <zdb2/db/writer_queue.hpp>
+#include <zdb2/db/sqlite/sqlite_backend.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the SQLite deployment for many threads : the database is in WAL mode and every connection has its
+	 * own page cache,a pool of read only connections serves the queries,and all the writes are run one
+	 * by one by a single writer connection in its own thread,fed by a lock free queue.The readers never
+	 * block the writer or each other,and the writes never fight over the database lock,so there is no
+	 * SQLITE_BUSY or SQLITE_LOCKED storm.Every write returns a future of its result.
+	 * The pool parameters of the url (eg : "stmt-cache","trace") apply to both the readers and the writer,
+	 * except "group-commit" which only applies to the writer pool.
+	 * eg : auto db = std::make_shared<zdb2::sqlite_wal_pool>(std::make_shared<zdb2::url>("sqlite:///tmp/app.db3?synchronous=normal"));
+	 *      std::future<int64_t> f = db->exec("insert into t values(?,?)", 1, "a"); f.get();
+	 *      auto conn = db->get(); auto rs = conn->select("select * from t");
+	 */
+	class sqlite_wal_pool
+	{
+	public:
+		typedef basic_pool<sqlite_backend>       pool_type;
+		typedef sqlite_backend::connection_type  connection_type;
+
+		/**
+		 * @param url_ptr The url of the database
+		 * @param init_conn_count The initial number of the read only connections
+		 * @param conn_timeout The idle timeout in seconds of the connections
+		 * @param execute_timeout The query timeout in milliseconds
+		 * @param max_conn_count The maximum number of the read only connections
+		 * @param queue_size The capacity of the write queue,the callers wait while it is full
+		 */
+		sqlite_wal_pool(
+			std::shared_ptr<url> url_ptr,
+			std::size_t init_conn_count = zdb2::DEFAULT_INIT_CONNECTIONS,
+			std::size_t conn_timeout    = zdb2::DEFAULT_CONNECTION_TIMEOUT,
+			std::size_t execute_timeout = zdb2::DEFAULT_TIMEOUT,
+			std::size_t max_conn_count  = zdb2::DEFAULT_MAX_CONNECTIONS,
+			std::size_t queue_size      = zdb2::DEFAULT_WRITE_QUEUE_SIZE
+		)
+			: m_execute_timeout(execute_timeout)
+			, m_queue(queue_size)
+		{
+			// the writer is opened first,it turns the database into WAL mode before the readers open it
+			m_writer_pool = std::make_shared<pool_type>(_make_url(url_ptr, "shared-cache=false&journal_mode=wal"),
+				1, conn_timeout, execute_timeout, 1);
+			// the readers can't write,so they don't start a group commit writer
+			m_reader_pool = std::make_shared<pool_type>(_make_url(url_ptr, "shared-cache=false&read-only=true",
+				{ "group-commit", "group-commit-size" }), init_conn_count, conn_timeout, execute_timeout, max_conn_count);
+
+			m_thread = std::thread([this]()
+			{
+				_run();
+			});
+		}
+
+		virtual ~sqlite_wal_pool()
+		{
+			stop();
+		}
+
+		/**
+		 * Get a read only connection from the reader pool,see basic_pool::get.
+		 */
+		std::shared_ptr<connection_type> get()
+		{
+			return m_reader_pool->get();
+		}
+
+		/**
+		 * Get a read only connection from the reader pool,wait until a connection is available or the
+		 * timeout is reached,see basic_pool::get_for.
+		 */
+		std::shared_ptr<connection_type> get_for(std::chrono::milliseconds timeout)
+		{
+			return m_reader_pool->get_for(timeout);
+		}
+
+		/**
+		 * Run the function with the writer connection in the writer thread,after the writes queued
+		 * before it.The function should not keep the connection or block.
+		 * eg : auto f = db->submit([](zdb2::sqlite_connection & conn) { return conn.exec("delete from t"); });
+		 * @param f The function,it is called as f(connection_type &)
+		 * @return The future of the result of the function,it holds the exception if the function throws
+		 * @exception SQLException If the pool is stopped
+		 */
+		template<typename F>
+		std::future<typename std::result_of<F(connection_type &)>::type> submit(F f)
+		{
+			typedef typename std::result_of<F(connection_type &)>::type result_type;
+
+			write_task_impl<result_type> * task = new write_task_impl<result_type>(std::move(f));
+			std::future<result_type> future = task->promise.get_future();
+
+			_push(task);
+
+			return future;
+		}
+
+		/**
+		 * Executes the given SQL statement with the parameters in the writer thread,see connection::exec.
+		 * The statement is prepared from the statement cache of the writer connection.
+		 * The parameters are copied,the strings and the blobs don't need to live until the write is done.
+		 * eg : db->exec("update t set x=? where id=?", 12.34, id);
+		 * @param sql A single SQL statement with '?' IN parameter placeholders
+		 * @return The future of the number of rows changed by the statement
+		 * @exception SQLException If the pool is stopped
+		 */
+		template<typename... Args>
+		std::future<int64_t> exec(const char * sql, const Args&... args)
+		{
+			if (!sql || sql[0] == '\0')
+				throw std::runtime_error("invalid parameters.");
+
+			std::string text(sql);
+			auto values = make_stored_args(args...);
+
+			return submit([text, values](connection_type & conn) -> int64_t
+			{
+				return values.exec(conn, text.c_str());
+			});
+		}
+
+		/**
+		 * Stop the writer thread after the queued writes are done,the writes submitted after it throw.
+		 * It is called by the destructor.
+		 */
+		void stop()
+		{
+			if (!m_queue.stop())
+				return;
+
+			if (m_thread.joinable())
+				m_thread.join();
+
+			m_queue.drain([](write_task * task)
+			{
+				task->fail(std::make_exception_ptr(std::runtime_error("the writer is stopped.")));
+				delete task;
+			});
+		}
+
+		/**
+		 * Returns the approximate count of the writes waiting in the queue.
+		 */
+		std::size_t get_queue_size()
+		{
+			return m_queue.size();
+		}
+
+		/// the pool of the read only connections
+		std::shared_ptr<pool_type> get_reader_pool()
+		{
+			return m_reader_pool;
+		}
+
+		/// the pool of the single writer connection
+		std::shared_ptr<pool_type> get_writer_pool()
+		{
+			return m_writer_pool;
+		}
+
+	protected:
+		struct write_task
+		{
+			virtual ~write_task()
+			{
+			}
+
+			virtual void run(connection_type & conn) = 0;
+
+			virtual void fail(std::exception_ptr e) = 0;
+		};
+
+		template<typename R, typename = void>
+		struct write_task_impl : public write_task
+		{
+			template<typename F>
+			explicit write_task_impl(F && f) : function(std::forward<F>(f))
+			{
+			}
+
+			virtual void run(connection_type & conn) override
+			{
+				try
+				{
+					promise.set_value(function(conn));
+				}
+				catch (...)
+				{
+					promise.set_exception(std::current_exception());
+				}
+			}
+
+			virtual void fail(std::exception_ptr e) override
+			{
+				promise.set_exception(e);
+			}
+
+			std::function<R(connection_type &)> function;
+			std::promise<R> promise;
+		};
+
+		/// the write returns nothing,std::promise<void>::set_value takes no value
+		template<typename Dummy>
+		struct write_task_impl<void, Dummy> : public write_task
+		{
+			template<typename F>
+			explicit write_task_impl(F && f) : function(std::forward<F>(f))
+			{
+			}
+
+			virtual void run(connection_type & conn) override
+			{
+				try
+				{
+					function(conn);
+					promise.set_value();
+				}
+				catch (...)
+				{
+					promise.set_exception(std::current_exception());
+				}
+			}
+
+			virtual void fail(std::exception_ptr e) override
+			{
+				promise.set_exception(e);
+			}
+
+			std::function<void(connection_type &)> function;
+			std::promise<void> promise;
+		};
+
+		/**
+		 * the url with the parameters of the readers or the writer,they are put before the parameters
+		 * of the user,so they take effect.The user's parameters named in excluded are dropped.
+		 */
+		static std::shared_ptr<url> _make_url(std::shared_ptr<url> url_ptr, const char * params,
+			std::initializer_list<const char *> excluded = {})
+		{
+			std::string s = url_ptr->to_string();
+			std::size_t pos = s.find('?');
+			if (pos == std::string::npos)
+				return std::make_shared<url>((s + "?" + params).c_str());
+
+			std::string query = s.substr(pos + 1);
+			s = s.substr(0, pos + 1) + params;
+
+			std::size_t begin = 0;
+			while (begin < query.size())
+			{
+				std::size_t end = query.find('&', begin);
+				if (end == std::string::npos)
+					end = query.size();
+
+				std::string param = query.substr(begin, end - begin);
+				std::string name = param.substr(0, param.find('='));
+				if (!param.empty() && std::find_if(excluded.begin(), excluded.end(), [&name](const char * x)
+				{
+					return name == x;
+				}) == excluded.end())
+				{
+					s += "&" + param;
+				}
+
+				begin = end + 1;
+			}
+			return std::make_shared<url>(s.c_str());
+		}
+
+		void _push(write_task * task)
+		{
+			if (!m_queue.push(task))
+			{
+				delete task;
+				throw std::runtime_error("the writer is stopped.");
+			}
+		}
+
+		/**
+		 * the writer thread,it keeps the writer connection while there are writes in the queue.
+		 */
+		void _run()
+		{
+			std::shared_ptr<connection_type> conn;
+			write_task * task = nullptr;
+			for (;;)
+			{
+				if (m_queue.try_pop(task))
+				{
+					_execute(conn, task);
+					continue;
+				}
+
+				// return the connection to the pool while idle,so it is checked and reaped as usual
+				conn.reset();
+
+				if (m_queue.is_stopped())
+					break;
+
+				m_queue.wait_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+			}
+		}
+
+		void _execute(std::shared_ptr<connection_type> & conn, write_task * task)
+		{
+			if (!conn)
+			{
+				try
+				{
+					conn = m_writer_pool->get_for(std::chrono::milliseconds(m_execute_timeout));
+				}
+				catch (...)
+				{
+					task->fail(std::current_exception());
+					delete task;
+					return;
+				}
+			}
+
+			if (conn)
+				task->run(*conn);
+			else
+				task->fail(std::make_exception_ptr(std::runtime_error("no connection is available.")));
+
+			delete task;
+		}
+
+	private:
+		/// no copy construct function
+		sqlite_wal_pool(const sqlite_wal_pool&) = delete;
+
+		/// no operator equal function
+		sqlite_wal_pool& operator=(const sqlite_wal_pool&) = delete;
+
+	protected:
+
+		std::size_t m_execute_timeout = zdb2::DEFAULT_TIMEOUT;
+
+		std::shared_ptr<pool_type> m_writer_pool;
+		std::shared_ptr<pool_type> m_reader_pool;
+
+		/// the writes,many callers push and the writer thread pops
+		writer_queue<write_task *> m_queue;
+
+		std::thread m_thread;
+	};
+
+}
@@ -16,14 +16,50 @@
 #include <algorithm>
 #include <mutex>
 #include <stdexcept>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+#include <tuple>
+#include <functional>
 
 #include <zdb2/config.hpp>
+#include <zdb2/db/resultset.hpp>
 
 namespace zdb2
 {
 
-	class stmt
+	/**
+	 * a blob parameter for stmt::bind,connection::exec and connection::select,the data is not copied.
+	 */
+	struct blob
 	{
+		blob(const void * d, std::size_t n) : data(d), size(n)
+		{
+		}
+
+		const void * data = nullptr;
+		std::size_t size = 0;
+	};
+
+	/**
+	 * a GMT timestamp parameter for stmt::bind,connection::exec and connection::select,a plain time_t
+	 * is bound as a integer.
+	 */
+	struct timestamp
+	{
+		explicit timestamp(time_t t) : value(t)
+		{
+		}
+
+		time_t value = 0;
+	};
+
+	class connection;
+
+	class stmt : public std::enable_shared_from_this<stmt>
+	{
+		friend class connection;
+
 	public:
 		stmt(const char * sql, std::size_t timeout) : m_timeout(timeout)
 		{
@@ -40,6 +76,45 @@ namespace zdb2
 
 		virtual void close() = 0;
 
+		/**
+		 * Reset the statement to its initial state and clear all the parameters,
+		 * so it can be executed again with new parameters. A statement got from
+		 * the statement cache of the connection is already reset.
+		 * @param P A PreparedStatement object
+		 */
+		virtual void reset()
+		{
+		}
+
+		/**
+		 * Returns true if the sql is compiled successfully.
+		 * @param P A PreparedStatement object
+		 */
+		virtual bool is_prepared()
+		{
+			return true;
+		}
+
+		/**
+		 * Returns the sql text of this prepared statement.
+		 * @param P A PreparedStatement object
+		 */
+		const std::string & get_sql()
+		{
+			return m_sql;
+		}
+
+		/**
+		 * Returns the sql text with the values of the parameters in place of the
+		 * placeholders,it is used by the slow query log of the tracer. The 
+		 * backends which can't read the values return the sql text.
+		 * @param P A PreparedStatement object
+		 */
+		virtual std::string get_expanded_sql()
+		{
+			return m_sql;
+		}
+
 		/** @name Parameters */
 		//@{
 
@@ -140,6 +215,82 @@ namespace zdb2
 		 */
 		virtual void set_timestamp(int param_index, time_t x) = 0;
 
+		/**
+		 * Sets the <i>in</i> parameter by the type of x,the set_xxx method is 
+		 * chosen at compile time : the integers not wider than int are set by 
+		 * set_int,the other integers by set_int64,the floating point numbers by 
+		 * set_double,the strings by set_string,nullptr is SQL NULL,zdb2::blob 
+		 * and zdb2::timestamp by set_blob and set_timestamp. The string and blob 
+		 * are not copied,they must be valid until the statement is executed,for
+		 * a query until the first row is fetched.
+		 * @param P A PreparedStatement object
+		 * @param parameterIndex The first parameter is 1, the second is 2,..
+		 * @param x The value to set
+		 */
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value>::type bind(int param_index, T x)
+		{
+			if (sizeof(T) < sizeof(int) || (sizeof(T) == sizeof(int) && std::is_signed<T>::value))
+				set_int(param_index, (int)x);
+			else
+				set_int64(param_index, (int64_t)x);
+		}
+
+		template<typename T>
+		typename std::enable_if<std::is_floating_point<T>::value>::type bind(int param_index, T x)
+		{
+			set_double(param_index, (double)x);
+		}
+
+		void bind(int param_index, const char * x)
+		{
+			set_string(param_index, x);
+		}
+
+		void bind(int param_index, const std::string & x)
+		{
+			set_string(param_index, x.c_str());
+		}
+
+		void bind(int param_index, std::nullptr_t)
+		{
+			set_string(param_index, nullptr);
+		}
+
+		void bind(int param_index, const blob & x)
+		{
+			set_blob(param_index, x.data, x.size);
+		}
+
+		void bind(int param_index, const timestamp & x)
+		{
+			set_timestamp(param_index, x.value);
+		}
+
+		/**
+		 * Sets all the <i>in</i> parameters in order,the first argument is the 
+		 * parameter 1,see bind.
+		 * @param P A PreparedStatement object
+		 */
+		template<typename... Args>
+		void bind_all(const Args&... args)
+		{
+			_bind_from(1, args...);
+		}
+
+		/**
+		 * Sets the <i>in</i> parameters from the elements of the tuple in order,
+		 * the first element is the parameter <code>first_index</code>,see bind.
+		 * @param P A PreparedStatement object
+		 * @param row A std::tuple of the values to set
+		 * @param first_index The index of the parameter set by the first element
+		 */
+		template<typename... Args>
+		void bind_row(const std::tuple<Args...> & row, int first_index = 1)
+		{
+			_bind_tuple<0>(first_index, row);
+		}
+
 		//@}
 
 		/**
@@ -164,6 +315,47 @@ namespace zdb2
 		virtual int64_t rows_changed() = 0;
 
 
+		/**
+		 * Executes the prepared SQL statement once for every row,a row is a 
+		 * std::tuple of the parameters (see bind_row). The statement is bound
+		 * and executed again without being prepared again,but the rows are not
+		 * wrapped in a transaction,see connection::insert_many.
+		 * eg : s->execute_batch(std::vector<std::tuple<int, std::string>>{...});
+		 * @param P A PreparedStatement object
+		 * @param rows A range of std::tuple
+		 * @return The number of rows changed by all the executions
+		 * @exception SQLException If a database error occurs
+		 */
+		template<typename Rows>
+		int64_t execute_batch(const Rows & rows)
+		{
+			int64_t changed = 0;
+			for (const auto & row : rows)
+			{
+				bind_row(row);
+				execute();
+				changed += rows_changed();
+			}
+			return changed;
+		}
+
+
+		/**
+		 * Executes the prepared SQL statement, which returns a single ResultSet
+		 * object. The ResultSet "lives" only until the statement is executed
+		 * again or closed.
+		 * @param P A PreparedStatement object
+		 * @return A ResultSet object that contains the data produced by the
+		 * prepared statement.
+		 * @exception SQLException If a database error occurs
+		 */
+		virtual std::shared_ptr<resultset> query()
+		{
+			throw std::runtime_error("query is not supported by this statement.");
+			return nullptr;
+		}
+
+
 		/** @name Properties */
 		//@{
 
@@ -182,6 +374,80 @@ namespace zdb2
 	protected:
 		virtual void _init() = 0;
 
+		/**
+		 * called by the backends after the statement is executed successfully.
+		 */
+		void _executed()
+		{
+			if (m_on_execute)
+				m_on_execute();
+		}
+
+		/**
+		 * Returns the tracer of the connection,nullptr if the tracing is disabled.
+		 */
+		tracer * _tracer()
+		{
+			return (m_tracer ? m_tracer->get() : nullptr);
+		}
+
+		/**
+		 * record a execution of the statement which returns no rows,or a execution which failed,see tracer.
+		 * @param start When the execution began
+		 * @param error The execution failed
+		 */
+		void _trace_execute(tracer & t, std::chrono::steady_clock::time_point start, bool error = false)
+		{
+			m_span.execute_time = trace_span::elapsed(start);
+			m_span.error = error;
+			t.begin(m_span, m_sql.c_str());
+			t.finish(m_span, [this]()
+			{
+				return get_expanded_sql();
+			});
+		}
+
+		/**
+		 * pass the trace of the execution to the resultset,which records it after the rows are fetched,
+		 * the values of the parameters are taken now,the bound strings may be gone by then.
+		 * @param start When the execution began
+		 */
+		void _trace_query(tracer & t, std::chrono::steady_clock::time_point start, resultset & rs)
+		{
+			m_span.execute_time = trace_span::elapsed(start);
+			t.begin(m_span, m_sql.c_str());
+			if (t.has_slow_query_sink())
+				m_span.expanded_sql = get_expanded_sql();
+
+			rs.m_span = m_span;
+			rs.m_tracer = *m_tracer;
+
+			m_span.clear();
+		}
+
+		void _bind_from(int)
+		{
+		}
+
+		template<typename T, typename... Args>
+		void _bind_from(int param_index, const T & x, const Args&... args)
+		{
+			bind(param_index, x);
+			_bind_from(param_index + 1, args...);
+		}
+
+		template<std::size_t I, typename... Args>
+		typename std::enable_if<(I == sizeof...(Args))>::type _bind_tuple(int, const std::tuple<Args...> &)
+		{
+		}
+
+		template<std::size_t I, typename... Args>
+		typename std::enable_if<(I < sizeof...(Args))>::type _bind_tuple(int param_index, const std::tuple<Args...> & row)
+		{
+			bind(param_index, std::get<I>(row));
+			_bind_tuple<I + 1>(param_index + 1, row);
+		}
+
 	protected:
 
 		std::size_t m_timeout = zdb2::DEFAULT_TIMEOUT;
@@ -190,6 +456,17 @@ namespace zdb2
 
 		std::string m_sql;
 
+		/// the string and blob parameters are copied by the backend,set by connection::select,because
+		/// the query runs after the arguments are gone,eg : SQLite steps it in resultset::next_row
+		bool m_copy_params = false;
+
+		/// set by the connection if the statement writes the tables,see connection::_listen
+		std::function<void()> m_on_execute;
+
+		/// the tracer of the connection,and the trace of the current execution,see connection::_listen
+		const std::shared_ptr<tracer> * m_tracer = nullptr;
+		trace_span m_span;
+
 	};
 
 }
@@ -0,0 +1,216 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <iterator>
+
+#include <zdb2/config.hpp>
+#include <zdb2/db/stmt.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the statistics of the statement cache,see connection::get_stmt_cache_stats.
+	 */
+	struct stmt_cache_stats
+	{
+		std::uint64_t hits = 0;
+		std::uint64_t misses = 0;
+		std::uint64_t evictions = 0;
+
+		std::size_t size = 0;
+		std::size_t capacity = 0;
+	};
+
+	/**
+	 * the prepared statements of a connection keyed by the sql text,the least recently used statement
+	 * is closed when the cache is full.it is not thread safe,a connection is used by one thread at a time.
+	 * a statement which is still held by the caller is never handed out again,so two handles never share
+	 * one statement.
+	 */
+	class stmt_cache
+	{
+	public:
+		explicit stmt_cache(std::size_t capacity = zdb2::DEFAULT_STMT_CACHE_SIZE) : m_capacity(capacity)
+		{
+		}
+
+		~stmt_cache()
+		{
+			clear();
+		}
+
+		/**
+		 * Returns the cached statement of the sql and marks it as the most recently used.
+		 * @return nullptr if the sql is not cached or the cached statement is still held by the caller
+		 */
+		std::shared_ptr<stmt> get(const char * sql)
+		{
+			list_type::iterator it;
+			if (!_find(sql, it) || it->second.use_count() > 1)
+			{
+				m_misses++;
+				return nullptr;
+			}
+
+			m_list.splice(m_list.begin(), m_list, it);
+
+			m_hits++;
+			return it->second;
+		}
+
+		/**
+		 * Put the statement into the cache as the most recently used one,the least recently used
+		 * statement is evicted if the cache is full.
+		 */
+		void put(const char * sql, std::shared_ptr<stmt> s)
+		{
+			if (m_capacity == 0 || !s)
+				return;
+
+			list_type::iterator it;
+			if (_find(sql, it))
+			{
+				// keep the cached one if the caller is still using it
+				if (it->second.use_count() > 1)
+					return;
+
+				_erase(it);
+			}
+
+			while (m_list.size() >= m_capacity)
+			{
+				_erase(std::prev(m_list.end()));
+				m_evictions++;
+			}
+
+			m_list.emplace_front(sql, std::move(s));
+			m_map.emplace(_hash(sql), m_list.begin());
+		}
+
+		/**
+		 * close all the cached statements,must be called before the database handle is closed.
+		 */
+		void clear()
+		{
+			m_map.clear();
+			m_list.clear();
+		}
+
+		void set_capacity(std::size_t capacity)
+		{
+			m_capacity = capacity;
+
+			while (m_list.size() > m_capacity)
+			{
+				_erase(std::prev(m_list.end()));
+				m_evictions++;
+			}
+		}
+
+		std::size_t get_capacity() const
+		{
+			return m_capacity;
+		}
+
+		std::size_t size() const
+		{
+			return m_list.size();
+		}
+
+		std::uint64_t get_hits() const
+		{
+			return m_hits;
+		}
+
+		std::uint64_t get_misses() const
+		{
+			return m_misses;
+		}
+
+		std::uint64_t get_evictions() const
+		{
+			return m_evictions;
+		}
+
+	private:
+		/// no copy construct function
+		stmt_cache(const stmt_cache&) = delete;
+
+		/// no operator equal function
+		stmt_cache& operator=(const stmt_cache&) = delete;
+
+	protected:
+
+		typedef std::list<std::pair<std::string, std::shared_ptr<stmt>>> list_type;
+
+		/// FNV-1a hash of the sql text,so the lookup don't need to make a std::string
+		static std::size_t _hash(const char * sql)
+		{
+			std::uint64_t h = 14695981039346656037ULL;
+			for (; *sql; sql++)
+			{
+				h ^= (unsigned char)(*sql);
+				h *= 1099511628211ULL;
+			}
+			return (std::size_t)h;
+		}
+
+		bool _find(const char * sql, list_type::iterator & it)
+		{
+			auto range = m_map.equal_range(_hash(sql));
+			for (auto i = range.first; i != range.second; i++)
+			{
+				if (i->second->first == sql)
+				{
+					it = i->second;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void _erase(list_type::iterator it)
+		{
+			auto range = m_map.equal_range(_hash(it->first.c_str()));
+			for (auto i = range.first; i != range.second; i++)
+			{
+				if (i->second == it)
+				{
+					m_map.erase(i);
+					break;
+				}
+			}
+			m_list.erase(it);
+		}
+
+	protected:
+
+		/// the most recently used statement is at the front
+		list_type m_list;
+
+		/// the hash of the sql text to the statements
+		std::unordered_multimap<std::size_t, list_type::iterator> m_map;
+
+		std::size_t m_capacity = zdb2::DEFAULT_STMT_CACHE_SIZE;
+
+		std::uint64_t m_hits = 0;
+		std::uint64_t m_misses = 0;
+		std::uint64_t m_evictions = 0;
+	};
+
+}
@@ -0,0 +1,108 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include <zdb2/db/stmt.hpp>
+#include <zdb2/db/connection.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the parameters of a connection::exec call copied for a later execution in another thread,the
+	 * strings and the blobs are copied,so the caller's buffers don't need to live until it runs.
+	 * eg : auto args = zdb2::make_stored_args(1, "a"); ... args.exec(conn, "insert into t values(?,?)");
+	 */
+	template<typename... Args>
+	class stored_args
+	{
+	public:
+		template<typename... Values>
+		explicit stored_args(const Values&... values) : m_values(values...)
+		{
+		}
+
+		/**
+		 * Executes the sql with the stored parameters by the connection,see connection::exec.
+		 */
+		int64_t exec(connection & conn, const char * sql) const
+		{
+			return _exec(conn, sql, typename _indices<sizeof...(Args)>::type());
+		}
+
+	protected:
+		struct text
+		{
+			text(const char * x) : is_null(x == nullptr), value(x ? x : "")
+			{
+			}
+
+			bool is_null;
+			std::string value;
+		};
+
+		struct bytes
+		{
+			bytes(const blob & x) : value((const char *)x.data, x.data ? x.size : 0)
+			{
+			}
+
+			std::string value;
+		};
+
+		template<typename T, typename = void> struct _stored { typedef T     type; };
+		template<typename D> struct _stored<char *, D>       { typedef text  type; };
+		template<typename D> struct _stored<const char *, D> { typedef text  type; };
+		template<typename D> struct _stored<blob, D>         { typedef bytes type; };
+
+		template<typename T>
+		static const T & _load(const T & x)
+		{
+			return x;
+		}
+
+		static const char * _load(const text & x)
+		{
+			return (x.is_null ? nullptr : x.value.c_str());
+		}
+
+		static blob _load(const bytes & x)
+		{
+			return blob(x.value.data(), x.value.size());
+		}
+
+		template<std::size_t... I> struct _index_list {};
+		template<std::size_t N, std::size_t... I> struct _indices : _indices<N - 1, N - 1, I...> {};
+		template<std::size_t... I> struct _indices<0, I...> { typedef _index_list<I...> type; };
+
+		template<std::size_t... I>
+		int64_t _exec(connection & conn, const char * sql, _index_list<I...>) const
+		{
+			return conn.exec(sql, _load(std::get<I>(m_values))...);
+		}
+
+	protected:
+		std::tuple<typename _stored<Args>::type...> m_values;
+	};
+
+	template<typename... Args>
+	stored_args<typename std::decay<Args>::type...> make_stored_args(const Args&... args)
+	{
+		return stored_args<typename std::decay<Args>::type...>(args...);
+	}
+
+}
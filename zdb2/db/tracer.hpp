@@ -0,0 +1,446 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+
+#include <zdb2/config.hpp>
+#include <zdb2/util/histogram.hpp>
+#include <zdb2/util/striped_counter.hpp>
+#include <zdb2/util/rwlock.hpp>
+#include <zdb2/util/sql_fingerprint.hpp>
+
+namespace zdb2
+{
+
+	class tracer;
+	class statement_stats;
+
+	/**
+	 * the statistics of a statement fingerprint,see tracer::get_stats,the times are in microseconds.
+	 */
+	struct statement_stats_snapshot
+	{
+		/// the fingerprint of the sql,see sql_fingerprint
+		std::string sql;
+
+		/// count of the executions,including the failed ones
+		std::uint64_t calls = 0;
+
+		/// count of the executions which failed
+		std::uint64_t errors = 0;
+
+		/// count of the executions which were longer than the slow query threshold
+		std::uint64_t slow_calls = 0;
+
+		/// count of the rows fetched and the bytes of their values
+		std::uint64_t rows = 0;
+		std::uint64_t bytes = 0;
+
+		/// the sum of the prepare,execute and fetch time of every execution,eg : total_time.sum,
+		/// total_time.min,total_time.max,total_time.percentile(99)
+		histogram_snapshot total_time;
+
+		histogram_snapshot prepare_time;
+		histogram_snapshot execute_time;
+		histogram_snapshot fetch_time;
+	};
+
+	/**
+	 * a execution which was longer than the slow query threshold,see tracer::set_slow_query_sink.
+	 */
+	struct slow_query
+	{
+		/// the fingerprint of the sql
+		std::string sql;
+
+		/// the sql as it was executed,with the values of the parameters in place of the placeholders
+		std::string expanded_sql;
+
+		std::chrono::microseconds prepare_time{ 0 };
+		std::chrono::microseconds execute_time{ 0 };
+		std::chrono::microseconds fetch_time{ 0 };
+
+		std::uint64_t rows = 0;
+		std::uint64_t bytes = 0;
+
+		/// the execution failed
+		bool error = false;
+
+		std::chrono::microseconds total_time() const
+		{
+			return prepare_time + execute_time + fetch_time;
+		}
+	};
+
+	/**
+	 * the measures of one execution of a statement,they are added to the statement_stats when the
+	 * execution is finished,the times are in microseconds.
+	 */
+	struct trace_span
+	{
+		/// the statistics of the statement,and the tracer which they belong to
+		std::shared_ptr<statement_stats> stats;
+		const tracer * owner = nullptr;
+
+		std::uint64_t prepare_time = 0;
+		std::uint64_t execute_time = 0;
+		std::uint64_t fetch_time = 0;
+
+		std::uint64_t rows = 0;
+		std::uint64_t bytes = 0;
+
+		bool error = false;
+
+		/// the sql with the values of the parameters,taken when the values may be gone at the end
+		std::string expanded_sql;
+
+		/// clear the measures,the statistics of the statement are kept for the next execution
+		void clear()
+		{
+			prepare_time = execute_time = fetch_time = 0;
+			rows = bytes = 0;
+			error = false;
+			expanded_sql.clear();
+		}
+
+		static std::uint64_t elapsed(std::chrono::steady_clock::time_point start)
+		{
+			return (std::uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	/**
+	 * the latency statistics of a statement fingerprint,it is thread safe and lock free.
+	 */
+	class statement_stats
+	{
+	public:
+		explicit statement_stats(std::string sql) : m_sql(std::move(sql))
+		{
+		}
+
+		const std::string & get_sql() const
+		{
+			return m_sql;
+		}
+
+		void record(const trace_span & span, bool slow)
+		{
+			m_calls.add();
+			if (span.error)
+				m_errors.add();
+			if (slow)
+				m_slow_calls.add();
+			if (span.rows > 0)
+				m_rows.add(span.rows);
+			if (span.bytes > 0)
+				m_bytes.add(span.bytes);
+
+			// a cached statement is prepared once for many executions
+			if (span.prepare_time > 0)
+				m_prepare_time.record(span.prepare_time);
+			m_execute_time.record(span.execute_time);
+			m_fetch_time.record(span.fetch_time);
+			m_total_time.record(span.prepare_time + span.execute_time + span.fetch_time);
+		}
+
+		statement_stats_snapshot snapshot() const
+		{
+			statement_stats_snapshot s;
+			s.sql          = m_sql;
+			s.calls        = m_calls.load();
+			s.errors       = m_errors.load();
+			s.slow_calls   = m_slow_calls.load();
+			s.rows         = m_rows.load();
+			s.bytes        = m_bytes.load();
+			s.total_time   = m_total_time.snapshot();
+			s.prepare_time = m_prepare_time.snapshot();
+			s.execute_time = m_execute_time.snapshot();
+			s.fetch_time   = m_fetch_time.snapshot();
+			return s;
+		}
+
+	protected:
+		std::string m_sql;
+
+		striped_counter<> m_calls;
+		striped_counter<> m_errors;
+		striped_counter<> m_slow_calls;
+		striped_counter<> m_rows;
+		striped_counter<> m_bytes;
+
+		histogram m_total_time;
+		histogram m_prepare_time;
+		histogram m_execute_time;
+		histogram m_fetch_time;
+
+	private:
+		/// no copy construct function
+		statement_stats(const statement_stats&) = delete;
+
+		/// no operator equal function
+		statement_stats& operator=(const statement_stats&) = delete;
+	};
+
+	/**
+	 * the statement tracer of a pool,it aggregates the prepare,execute and fetch times,the rows,the bytes
+	 * and the errors of every execution per statement fingerprint (the literals are stripped and the IN
+	 * lists are collapsed,see sql_fingerprint),and passes the executions longer than the slow query 
+	 * threshold with the values of the parameters to the slow query sink.The statistics are found by the
+	 * hash of the fingerprint without any memory allocation,and are recorded lock free,so it can be used
+	 * by all the connections at the same time.see pool::enable_tracing.
+	 */
+	class tracer
+	{
+	public:
+		typedef std::function<void(const slow_query &)> slow_query_sink;
+
+		explicit tracer(
+			std::chrono::microseconds slow_threshold = std::chrono::milliseconds(zdb2::DEFAULT_SLOW_QUERY_THRESHOLD),
+			std::size_t max_statements = zdb2::DEFAULT_TRACE_STATEMENTS
+		)
+			: m_slow_threshold((std::uint64_t)slow_threshold.count())
+			, m_max_statements(max_statements)
+		{
+		}
+
+		/**
+		 * Set the threshold of the slow queries,zero disables the slow query check.
+		 * Set it before the tracer is used,it is not thread safe.
+		 */
+		void set_slow_threshold(std::chrono::microseconds threshold)
+		{
+			m_slow_threshold = (std::uint64_t)threshold.count();
+		}
+
+		std::chrono::microseconds get_slow_threshold() const
+		{
+			return std::chrono::microseconds(m_slow_threshold);
+		}
+
+		/**
+		 * Set the function which receives the slow queries,it is called in the thread which ran the
+		 * statement,so it should not block.Set it before the tracer is used,it is not thread safe.
+		 */
+		void set_slow_query_sink(slow_query_sink sink)
+		{
+			m_sink = std::move(sink);
+		}
+
+		/**
+		 * Returns true if the slow queries are passed to a sink,the values of the parameters are only
+		 * read for them.
+		 */
+		bool has_slow_query_sink() const
+		{
+			return (m_sink && m_slow_threshold > 0);
+		}
+
+		/**
+		 * Returns the statistics of the fingerprint of the statement,they are created by the first
+		 * execution of it,the fingerprints beyond max_statements share the statistics of "(other)".
+		 */
+		std::shared_ptr<statement_stats> find(const char * sql)
+		{
+			std::uint64_t key = sql_fingerprint::hash(sql);
+			{
+				rlock_guard g(m_lock);
+				auto it = m_statements.find(key);
+				if (it != m_statements.end())
+					return it->second;
+			}
+
+			std::string fingerprint = sql_fingerprint::text(sql);
+
+			wlock_guard g(m_lock);
+			auto it = m_statements.find(key);
+			if (it != m_statements.end())
+				return it->second;
+
+			if (m_statements.size() >= m_max_statements)
+			{
+				if (!m_other)
+					m_other = std::make_shared<statement_stats>("(other)");
+				return m_other;
+			}
+
+			std::shared_ptr<statement_stats> stats = std::make_shared<statement_stats>(std::move(fingerprint));
+			m_statements.emplace(key, stats);
+			return stats;
+		}
+
+		/**
+		 * Make the span of a new execution of the statement,the statistics found before are reused
+		 * if they belong to this tracer.
+		 */
+		void begin(trace_span & span, const char * sql)
+		{
+			if (!span.stats || span.owner != this)
+			{
+				span.stats = find(sql);
+				span.owner = this;
+			}
+		}
+
+		/**
+		 * Record the execution,and pass it to the slow query sink if it is longer than the threshold,
+		 * the span is cleared.It never throws.
+		 * @param span The measures of the execution
+		 * @param expand Returns the sql with the values of the parameters,it is called only for a
+		 * slow query which has no span.expanded_sql
+		 */
+		void finish(trace_span & span, const std::function<std::string()> & expand = nullptr)
+		{
+			if (!span.stats)
+				return;
+
+			std::uint64_t total = span.prepare_time + span.execute_time + span.fetch_time;
+			bool slow = (m_slow_threshold > 0 && total >= m_slow_threshold);
+
+			span.stats->record(span, slow);
+
+			if (slow && m_sink)
+			{
+				try
+				{
+					slow_query q;
+					q.sql          = span.stats->get_sql();
+					q.expanded_sql = (!span.expanded_sql.empty() ? span.expanded_sql : (expand ? expand() : q.sql));
+					q.prepare_time = std::chrono::microseconds(span.prepare_time);
+					q.execute_time = std::chrono::microseconds(span.execute_time);
+					q.fetch_time   = std::chrono::microseconds(span.fetch_time);
+					q.rows         = span.rows;
+					q.bytes        = span.bytes;
+					q.error        = span.error;
+					m_sink(q);
+				}
+				catch (...)
+				{
+				}
+			}
+
+			span.clear();
+		}
+
+		/**
+		 * Returns the statistics of all the statements.
+		 */
+		std::vector<statement_stats_snapshot> get_stats()
+		{
+			std::vector<std::shared_ptr<statement_stats>> statements;
+			{
+				rlock_guard g(m_lock);
+				statements.reserve(m_statements.size() + 1);
+				for (auto & pair : m_statements)
+					statements.push_back(pair.second);
+				if (m_other)
+					statements.push_back(m_other);
+			}
+
+			std::vector<statement_stats_snapshot> v;
+			v.reserve(statements.size());
+			for (auto & stats : statements)
+				v.push_back(stats->snapshot());
+			return v;
+		}
+
+		/**
+		 * Returns the statistics of the n statements which took the most total time,the first is the
+		 * most expensive.
+		 */
+		std::vector<statement_stats_snapshot> top(std::size_t n)
+		{
+			std::vector<statement_stats_snapshot> v = get_stats();
+			auto by_total = [](const statement_stats_snapshot & a, const statement_stats_snapshot & b)
+			{
+				return a.total_time.sum > b.total_time.sum;
+			};
+			if (n < v.size())
+			{
+				std::partial_sort(v.begin(), v.begin() + n, v.end(), by_total);
+				v.resize(n);
+			}
+			else
+				std::sort(v.begin(), v.end(), by_total);
+			return v;
+		}
+
+		/**
+		 * Returns the top n statements as a text table,one line per statement,the times are in 
+		 * microseconds : total calls errors mean min max p99 rows sql
+		 */
+		std::string dump(std::size_t n)
+		{
+			std::string s = "total_us      calls     errors  mean_us   min_us    max_us    p99_us    rows        sql\n";
+			char line[256];
+			for (auto & stats : top(n))
+			{
+				std::snprintf(line, sizeof(line), "%-13llu %-9llu %-7llu %-9llu %-9llu %-9llu %-9llu %-11llu ",
+					(unsigned long long)stats.total_time.sum,
+					(unsigned long long)stats.calls,
+					(unsigned long long)stats.errors,
+					(unsigned long long)stats.total_time.mean(),
+					(unsigned long long)stats.total_time.min,
+					(unsigned long long)stats.total_time.max,
+					(unsigned long long)stats.total_time.percentile(99),
+					(unsigned long long)stats.rows);
+				s += line;
+				s += stats.sql;
+				s += '\n';
+			}
+			return s;
+		}
+
+		/**
+		 * Drop the statistics of all the statements,the executions running now are recorded into the
+		 * dropped statistics.
+		 */
+		void clear()
+		{
+			wlock_guard g(m_lock);
+			m_statements.clear();
+			m_other.reset();
+		}
+
+	protected:
+		/// the slow query threshold in microseconds
+		std::uint64_t m_slow_threshold = 0;
+
+		std::size_t m_max_statements = zdb2::DEFAULT_TRACE_STATEMENTS;
+
+		slow_query_sink m_sink;
+
+		rwlock m_lock;
+
+		std::unordered_map<std::uint64_t, std::shared_ptr<statement_stats>> m_statements;
+
+		/// the statistics of the statements beyond max_statements
+		std::shared_ptr<statement_stats> m_other;
+
+	private:
+		/// no copy construct function
+		tracer(const tracer&) = delete;
+
+		/// no operator equal function
+		tracer& operator=(const tracer&) = delete;
+	};
+
+}
@@ -0,0 +1,174 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <zdb2/util/mpmc_queue.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the queue of the writes of a single writer thread,see group_commit and sqlite_wal_pool : many callers
+	 * push the writes into a lock free queue,the writer thread pops them,and sleeps while the queue is empty.
+	 * A caller only takes the mutex to wake the writer up when the writer is going to sleep,the fences of
+	 * push and wait_until make sure a write pushed while the writer goes to sleep is never missed.
+	 * After stop,the pushes fail,and drain takes the writes which were queued before it.
+	 */
+	template<typename T>
+	class writer_queue
+	{
+	public:
+		/**
+		 * @param capacity The capacity of the queue,the callers wait while it is full
+		 */
+		explicit writer_queue(std::size_t capacity) : m_queue(capacity)
+		{
+		}
+
+		~writer_queue()
+		{
+		}
+
+		/**
+		 * push a write,and wake the writer thread up if it is sleeping,wait for a free cell while the
+		 * writer is behind.
+		 * @return false if the queue is stopped,the write is not queued
+		 */
+		bool push(const T & data)
+		{
+			m_pushing++;
+			if (m_stopped.load())
+			{
+				m_pushing--;
+				return false;
+			}
+
+			// the writer is behind,wait for a free cell
+			while (!m_queue.try_push(data))
+				std::this_thread::yield();
+
+			m_pushing--;
+
+			// the writer may be going to sleep,see wait_until
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_sleeping.load())
+				_wake();
+
+			return true;
+		}
+
+		/**
+		 * pop a write,it is called by the writer thread.
+		 */
+		bool try_pop(T & data)
+		{
+			return m_queue.try_pop(data);
+		}
+
+		/**
+		 * wait until a write is pushed,the queue is stopped,or the deadline,it is called by the writer thread.
+		 */
+		void wait_until(std::chrono::steady_clock::time_point deadline)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_sleeping.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_queue.empty() && !m_stopped.load())
+				m_cv.wait_until(lock, deadline);
+			m_sleeping.store(false);
+		}
+
+		/**
+		 * stop the queue and wake the writer thread up,the pushes after it fail.
+		 * @return false if the queue is stopped already
+		 */
+		bool stop()
+		{
+			if (m_stopped.exchange(true))
+				return false;
+
+			_wake();
+			return true;
+		}
+
+		bool is_stopped()
+		{
+			return m_stopped.load();
+		}
+
+		/**
+		 * pop all the writes left after stop,call it after the writer thread is finished.
+		 * @param f Called with every write left,eg : to fail and delete it
+		 */
+		template<typename F>
+		void drain(F && f)
+		{
+			// a caller may have checked m_stopped before it was set
+			while (m_pushing.load() > 0)
+				std::this_thread::yield();
+
+			T data;
+			while (m_queue.try_pop(data))
+				f(data);
+		}
+
+		/**
+		 * approximate count of the writes in the queue.
+		 */
+		std::size_t size()
+		{
+			return m_queue.size();
+		}
+
+		bool empty()
+		{
+			return m_queue.empty();
+		}
+
+	protected:
+		void _wake()
+		{
+			std::lock_guard<std::mutex> g(m_mutex);
+			m_cv.notify_one();
+		}
+
+	private:
+		/// no copy construct function
+		writer_queue(const writer_queue&) = delete;
+
+		/// no operator equal function
+		writer_queue& operator=(const writer_queue&) = delete;
+
+	protected:
+
+		/// the writes,many callers push and the writer thread pops
+		mpmc_queue<T> m_queue;
+
+		std::atomic<bool> m_stopped{ false };
+
+		/// the writer thread is waiting for a write
+		std::atomic<bool> m_sleeping{ false };
+
+		/// count of the callers which are pushing a write
+		std::atomic<int> m_pushing{ 0 };
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+	};
+
+}
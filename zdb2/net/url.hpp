@@ -57,6 +57,9 @@ namespace zdb2
 		std::string get_dbname() { return m_dbname; }
 		std::string get_port()   { return m_port; }
 
+		/// the url string
+		std::string to_string()  { return m_url; }
+
 		std::string get_param_value(std::string name)
 		{
 			auto iterator = m_params.find(name);
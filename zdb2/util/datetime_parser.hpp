@@ -0,0 +1,366 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+
+#include <zdb2/config.hpp>
+
+#if defined(ZDB2_HAS_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace zdb2
+{
+
+	/**
+	 * the fields of a date,a time or a date and time,see datetime_parser.
+	 */
+	struct datetime_value
+	{
+		int year = 0;
+
+		/// [1-12]
+		int month = 0;
+
+		/// [1-31]
+		int day = 0;
+
+		int hour = 0;
+		int minute = 0;
+		int second = 0;
+
+		/// the fraction of the second,the digits after the 6th are dropped
+		int microsecond = 0;
+
+		/// the offset from UTC in seconds,eg : +08:00 is 28800
+		int gmtoff = 0;
+
+		bool has_date = false;
+		bool has_time = false;
+		bool has_zone = false;
+	};
+
+	/**
+	 * the parser of the ISO 8601 and the SQL date and time strings :
+	 *     YYYY-MM-DD
+	 *     HH:MM[:SS[.ffffff]]
+	 *     YYYY-MM-DD[ T]HH:MM[:SS[.ffffff]][Z|+HH[:MM]|-HH[:MM]]
+	 * The MySQL zero date "0000-00-00" is accepted and is the epoch.It don't allocate memory,don't
+	 * depend on the locale or the timezone,and is thread safe.The fixed "YYYY-MM-DD HH:MM:SS" prefix,
+	 * which is what the databases return,is validated by 16 bytes at a time with SSE2.
+	 */
+	class datetime_parser
+	{
+	public:
+		/**
+		 * Parse the string of the size into the value.
+		 * @return false if the string is not a valid date,time or date and time
+		 */
+		static bool parse(const char * s, std::size_t size, datetime_value & v)
+		{
+			v = datetime_value();
+
+			if (!s)
+				return false;
+
+			const char * p = s;
+			const char * end = s + size;
+
+			if (size >= 19 && _parse_fixed(s, v))
+			{
+				p += 19;
+			}
+			else
+			{
+				if (end - p >= 10 && p[4] == '-')
+				{
+					if (!_parse_date(p, v) || !_check_date(v))
+						return false;
+					p += 10;
+
+					if (p == end)
+						return true;
+					if (*p != ' ' && *p != 'T' && *p != 't')
+						return false;
+					p++;
+				}
+
+				if (end - p < 5 || !_parse_hhmm(p, v))
+					return false;
+				p += 5;
+
+				if (end - p >= 3 && p[0] == ':')
+				{
+					if (!_is_digit(p[1]) || !_is_digit(p[2]))
+						return false;
+					v.second = _d2(p + 1);
+					p += 3;
+				}
+
+				v.has_time = true;
+			}
+
+			if (v.hour > 23 || v.minute > 59 || v.second > 60)
+				return false;
+
+			// the fraction
+			if (p < end && *p == '.')
+			{
+				p++;
+				const char * digits = p;
+				int scale = 100000;
+				while (p < end && _is_digit(*p))
+				{
+					v.microsecond += (*p - '0') * scale;
+					scale /= 10;
+					p++;
+				}
+				if (p == digits)
+					return false;
+			}
+
+			// the zone
+			if (p < end)
+			{
+				if (*p == 'Z' || *p == 'z')
+				{
+					p++;
+				}
+				else if (*p == '+' || *p == '-')
+				{
+					int sign = (*p == '-' ? -1 : 1);
+					p++;
+					if (end - p < 2 || !_is_digit(p[0]) || !_is_digit(p[1]))
+						return false;
+					int hh = _d2(p), mm = 0;
+					p += 2;
+					if (p < end && *p == ':')
+						p++;
+					if (end - p >= 2 && _is_digit(p[0]) && _is_digit(p[1]))
+					{
+						mm = _d2(p);
+						p += 2;
+					}
+					if (hh > 23 || mm > 59)
+						return false;
+					v.gmtoff = sign * (hh * 3600 + mm * 60);
+				}
+				else
+					return false;
+				v.has_zone = true;
+			}
+
+			return (p == end);
+		}
+
+		static bool parse(const char * s, datetime_value & v)
+		{
+			return parse(s, (s ? std::strlen(s) : 0), v);
+		}
+
+		/**
+		 * Returns the seconds since the epoch in UTC of the value,the gmt offset is subtracted.
+		 * A value with only a time is relative to 1970-01-01,and the MySQL zero date is 0.
+		 */
+		static time_t to_timestamp(const datetime_value & v)
+		{
+			std::int64_t days = 0;
+			if (v.has_date)
+			{
+				if (v.month == 0)
+					return (time_t)0;
+				days = days_from_civil(v.year, v.month, v.day);
+			}
+
+			return (time_t)(days * 86400 + v.hour * 3600 + v.minute * 60 + v.second - v.gmtoff);
+		}
+
+		/**
+		 * Returns the tm of the value,by the convention of resultset::get_datetime,tm_year is the year
+		 * literal and tm_mon is [0-11],the gmt offset is set to tm_gmtoff,or tm_wday on the systems
+		 * without tm_gmtoff.
+		 */
+		static std::tm to_tm(const datetime_value & v)
+		{
+			std::tm tm;
+			std::memset(&tm, 0, sizeof(tm));
+			if (v.has_date)
+			{
+				tm.tm_year = v.year;
+				tm.tm_mon = (v.month > 0 ? v.month - 1 : 0);
+				tm.tm_mday = v.day;
+			}
+			tm.tm_hour = v.hour;
+			tm.tm_min = v.minute;
+			tm.tm_sec = v.second;
+#if defined(ZDB2_HAS_TM_GMTOFF)
+			tm.tm_gmtoff = v.gmtoff;
+#else
+			tm.tm_wday = v.gmtoff;
+#endif
+			return tm;
+		}
+
+		/**
+		 * Returns the value in UTC of the seconds since the epoch,it is the thread safe std::gmtime.
+		 */
+		static datetime_value from_timestamp(time_t t)
+		{
+			datetime_value v;
+			std::int64_t secs = (std::int64_t)t;
+			std::int64_t days = secs / 86400;
+			std::int64_t rem = secs % 86400;
+			if (rem < 0)
+			{
+				rem += 86400;
+				days--;
+			}
+			civil_from_days(days, v.year, v.month, v.day);
+			v.hour = (int)(rem / 3600);
+			v.minute = (int)(rem % 3600 / 60);
+			v.second = (int)(rem % 60);
+			v.has_date = true;
+			v.has_time = true;
+			return v;
+		}
+
+		/**
+		 * Returns the number of days since 1970-01-01 of the date of the proleptic Gregorian calendar,
+		 * see http://howardhinnant.github.io/date_algorithms.html
+		 */
+		static std::int64_t days_from_civil(int y, int m, int d)
+		{
+			y -= (m <= 2);
+			const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+			const unsigned yoe = (unsigned)(y - era * 400);
+			const unsigned doy = (153 * (unsigned)(m + (m > 2 ? -3 : 9)) + 2) / 5 + (unsigned)d - 1;
+			const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+			return era * 146097 + (std::int64_t)doe - 719468;
+		}
+
+		static void civil_from_days(std::int64_t z, int & y, int & m, int & d)
+		{
+			z += 719468;
+			const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+			const unsigned doe = (unsigned)(z - era * 146097);
+			const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+			const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+			const unsigned mp = (5 * doy + 2) / 153;
+			d = (int)(doy - (153 * mp + 2) / 5 + 1);
+			m = (int)(mp < 10 ? mp + 3 : mp - 9);
+			y = (int)((std::int64_t)yoe + era * 400 + (m <= 2));
+		}
+
+	protected:
+		static bool _is_digit(char c)
+		{
+			return ((unsigned char)(c - '0') <= 9);
+		}
+
+		static int _d2(const char * p)
+		{
+			return (p[0] - '0') * 10 + (p[1] - '0');
+		}
+
+		static int _d4(const char * p)
+		{
+			return _d2(p) * 100 + _d2(p + 2);
+		}
+
+		/// the days of the month,or accept the MySQL zero date
+		static bool _check_date(const datetime_value & v)
+		{
+			if (v.year == 0 && v.month == 0 && v.day == 0)
+				return true;
+			if (v.month < 1 || v.month > 12 || v.day < 1)
+				return false;
+
+			static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+			bool leap = ((v.year % 4 == 0 && v.year % 100 != 0) || v.year % 400 == 0);
+			return (v.day <= days[v.month - 1] + (v.month == 2 && leap));
+		}
+
+		/// YYYY-MM-DD
+		static bool _parse_date(const char * p, datetime_value & v)
+		{
+			unsigned bad = 0;
+			for (int i : { 0, 1, 2, 3, 5, 6, 8, 9 })
+				bad |= (unsigned)((unsigned char)(p[i] - '0') > 9);
+			if (bad || p[4] != '-' || p[7] != '-')
+				return false;
+
+			v.year = _d4(p);
+			v.month = _d2(p + 5);
+			v.day = _d2(p + 8);
+			v.has_date = true;
+			return true;
+		}
+
+		/// HH:MM
+		static bool _parse_hhmm(const char * p, datetime_value & v)
+		{
+			if (!_is_digit(p[0]) || !_is_digit(p[1]) || p[2] != ':' || !_is_digit(p[3]) || !_is_digit(p[4]))
+				return false;
+
+			v.hour = _d2(p);
+			v.minute = _d2(p + 3);
+			return true;
+		}
+
+		/**
+		 * the "YYYY-MM-DD HH:MM:SS" or "YYYY-MM-DDTHH:MM:SS" prefix,the string has 19 bytes at least.
+		 */
+		static bool _parse_fixed(const char * s, datetime_value & v)
+		{
+#if defined(ZDB2_HAS_SSE2)
+			const __m128i x = _mm_loadu_si128((const __m128i *)s);
+			const __m128i d = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+
+			// the bytes in ['0','9'] : the unsigned min of d and 9 is d
+			const int digits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d));
+
+			// the separators at 4,7,10,13
+			const __m128i space = _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, ' ', 0, 0, ':', 0, 0);
+			const __m128i t = _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0);
+			const int separators = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, t)));
+
+			if ((digits & 0xDB6F) != 0xDB6F || (separators & 0x2490) != 0x2490 ||
+				s[16] != ':' || !_is_digit(s[17]) || !_is_digit(s[18]))
+				return false;
+
+			alignas(16) unsigned char b[16];
+			_mm_store_si128((__m128i *)b, d);
+
+			v.year = b[0] * 1000 + b[1] * 100 + b[2] * 10 + b[3];
+			v.month = b[5] * 10 + b[6];
+			v.day = b[8] * 10 + b[9];
+			v.hour = b[11] * 10 + b[12];
+			v.minute = b[14] * 10 + b[15];
+			v.second = _d2(s + 17);
+			v.has_date = true;
+#else
+			if (!_parse_date(s, v) || (s[10] != ' ' && s[10] != 'T') || !_parse_hhmm(s + 11, v) ||
+				s[16] != ':' || !_is_digit(s[17]) || !_is_digit(s[18]))
+				return false;
+
+			v.second = _d2(s + 17);
+#endif
+			v.has_time = true;
+			return _check_date(v);
+		}
+	};
+
+}
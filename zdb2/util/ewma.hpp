@@ -0,0 +1,63 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+namespace zdb2
+{
+
+	/**
+	 * exponentially weighted moving average,it is not thread safe.
+	 * value = alpha * sample + (1 - alpha) * value
+	 */
+	class ewma
+	{
+	public:
+		/**
+		 * @param alpha The weight of the newest sample,in range (0,1],the bigger the faster to follow the samples
+		 */
+		explicit ewma(double alpha = 0.3) : m_alpha(alpha)
+		{
+		}
+
+		void update(double sample)
+		{
+			if (!m_initialized)
+			{
+				m_value = sample;
+				m_initialized = true;
+			}
+			else
+			{
+				m_value = m_alpha * sample + (1.0 - m_alpha) * m_value;
+			}
+		}
+
+		double value() const
+		{
+			return m_value;
+		}
+
+		void reset()
+		{
+			m_value = 0;
+			m_initialized = false;
+		}
+
+	protected:
+
+		double m_alpha = 0.3;
+
+		double m_value = 0;
+
+		bool m_initialized = false;
+	};
+
+}
@@ -0,0 +1,137 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdarg>
+#include <memory>
+
+#include <zdb2/config.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * a printf style formatter for the sql text.the text is formatted in one pass into a inline buffer,
+	 * the heap is used only when the text don't fit into it,so the short statements are formatted
+	 * without any allocation.declare it on the stack of the caller,the text is valid until it is
+	 * formatted again or destroyed.
+	 */
+	class format_buffer
+	{
+	public:
+		format_buffer()
+		{
+			m_stack[0] = '\0';
+		}
+
+		~format_buffer()
+		{
+		}
+
+		/**
+		 * Format the text,the va_list is not consumed,so the caller still need to call va_end.
+		 * @return the formatted null terminated text,a empty text if the format string is invalid
+		 */
+		const char * vformat(const char * fmt, va_list ap)
+		{
+			va_list ap_copy;
+
+			va_copy(ap_copy, ap);
+			int len = std::vsnprintf(m_stack, sizeof(m_stack), fmt, ap_copy);
+			va_end(ap_copy);
+
+			if (len < 0)
+			{
+				m_stack[0] = '\0';
+				m_data = m_stack;
+				m_size = 0;
+				return m_data;
+			}
+
+			m_size = (std::size_t)len;
+
+			if (m_size < sizeof(m_stack))
+			{
+				m_data = m_stack;
+				return m_data;
+			}
+
+			// the text is truncated,format it again into a heap buffer which is big enough
+			if (m_size + 1 > m_heap_size)
+			{
+				m_heap.reset(new char[m_size + 1]);
+				m_heap_size = m_size + 1;
+			}
+
+			va_copy(ap_copy, ap);
+			std::vsnprintf(m_heap.get(), m_heap_size, fmt, ap_copy);
+			va_end(ap_copy);
+
+			m_data = m_heap.get();
+			return m_data;
+		}
+
+		const char * format(const char * fmt, ...)
+		{
+			va_list ap;
+			va_start(ap, fmt);
+
+			vformat(fmt, ap);
+
+			va_end(ap);
+
+			return m_data;
+		}
+
+		const char * c_str() const
+		{
+			return m_data;
+		}
+
+		std::size_t length() const
+		{
+			return m_size;
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		/**
+		 * whether the text is formatted into the inline buffer without allocation.
+		 */
+		bool is_inline() const
+		{
+			return (m_data == m_stack);
+		}
+
+	private:
+		/// no copy construct function
+		format_buffer(const format_buffer&) = delete;
+
+		/// no operator equal function
+		format_buffer& operator=(const format_buffer&) = delete;
+
+	protected:
+
+		char m_stack[zdb2::DEFAULT_FORMAT_BUFFER_SIZE];
+
+		std::unique_ptr<char[]> m_heap;
+		std::size_t m_heap_size = 0;
+
+		const char * m_data = m_stack;
+		std::size_t m_size = 0;
+	};
+
+}
@@ -0,0 +1,227 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ * referenced from : http://hdrhistogram.org
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+namespace zdb2
+{
+
+	/**
+	 * a snapshot of the histogram,see histogram::snapshot.
+	 */
+	class histogram_snapshot
+	{
+	public:
+		std::uint64_t count = 0;
+		std::uint64_t sum = 0;
+		std::uint64_t min = 0;
+		std::uint64_t max = 0;
+
+		/// the count of values recorded in every bucket
+		std::vector<std::uint64_t> buckets;
+
+		double mean() const
+		{
+			return (count > 0 ? (double)sum / (double)count : 0);
+		}
+
+		/**
+		 * Returns the value at the given percentile,the error is less than 1/16 of the value.
+		 * @param percentile In range [0,100],eg : 99.9
+		 */
+		std::uint64_t percentile(double percentile) const;
+	};
+
+	/**
+	 * a lock free HDR style histogram of unsigned integer values,the values in [2^n,2^(n+1)) are split into
+	 * 16 equal sub buckets,so the relative error of the recorded values is less than 1/16,and the memory is
+	 * fixed no matter how big the values are.record is wait free and can be called by many threads at the
+	 * same time.The count,the sum,the min and the max are split into stripes like striped_counter,every
+	 * thread records into its own stripe,so the threads don't contend on them.The buckets are shared by
+	 * all the threads,the recorded values spread over several buckets,and a stripe of the buckets for
+	 * every thread group would make a histogram 16 times bigger.
+	 */
+	class histogram
+	{
+	public:
+		/// 16 sub buckets every power of 2
+		static const std::size_t SUB_BUCKET_BITS = 4;
+		static const std::size_t SUB_BUCKET_COUNT = (std::size_t)1 << SUB_BUCKET_BITS;
+		static const std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+		/// the number of stripes,the same as striped_counter
+		static const std::size_t STRIPE_COUNT = 16;
+
+		histogram()
+		{
+			for (std::size_t i = 0; i < BUCKET_COUNT; i++)
+			{
+				m_buckets[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		~histogram()
+		{
+		}
+
+		void record(std::uint64_t value)
+		{
+			stripe & s = m_stripes[_index()];
+
+			m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+			s.count.fetch_add(1, std::memory_order_relaxed);
+			s.sum.fetch_add(value, std::memory_order_relaxed);
+
+			// the min and max are changed rarely,so load first to avoid writing the cache line,and only
+			// the threads of this stripe race on them
+			std::uint64_t min = s.min.load(std::memory_order_relaxed);
+			while (value < min && !s.min.compare_exchange_weak(min, value, std::memory_order_relaxed));
+
+			std::uint64_t max = s.max.load(std::memory_order_relaxed);
+			while (value > max && !s.max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+		}
+
+		histogram_snapshot snapshot() const
+		{
+			histogram_snapshot r;
+			r.buckets.resize((std::size_t)BUCKET_COUNT);
+
+			for (std::size_t j = 0; j < BUCKET_COUNT; j++)
+			{
+				r.buckets[j] = m_buckets[j].load(std::memory_order_relaxed);
+			}
+
+			std::uint64_t min = (std::numeric_limits<std::uint64_t>::max)();
+			for (std::size_t i = 0; i < STRIPE_COUNT; i++)
+			{
+				const stripe & s = m_stripes[i];
+				r.count += s.count.load(std::memory_order_relaxed);
+				r.sum += s.sum.load(std::memory_order_relaxed);
+				min = (std::min)(min, s.min.load(std::memory_order_relaxed));
+				r.max = (std::max)(r.max, s.max.load(std::memory_order_relaxed));
+			}
+
+			r.min = (r.count > 0 ? min : 0);
+
+			return r;
+		}
+
+		/**
+		 * Returns the sum of all the recorded values,cheaper than snapshot.
+		 */
+		std::uint64_t sum() const
+		{
+			std::uint64_t sum = 0;
+			for (std::size_t i = 0; i < STRIPE_COUNT; i++)
+			{
+				sum += m_stripes[i].sum.load(std::memory_order_relaxed);
+			}
+			return sum;
+		}
+
+		static std::size_t bucket_index(std::uint64_t value)
+		{
+			if (value < SUB_BUCKET_COUNT)
+				return (std::size_t)value;
+
+			// the index of the highest set bit
+			std::size_t msb = 0;
+			for (std::uint64_t v = value; v >>= 1;)
+				msb++;
+
+			std::size_t shift = msb - SUB_BUCKET_BITS;
+			std::size_t sub = (std::size_t)((value >> shift) & (SUB_BUCKET_COUNT - 1));
+
+			return (shift + 1) * SUB_BUCKET_COUNT + sub;
+		}
+
+		/**
+		 * Returns the highest value which is recorded into the bucket.
+		 */
+		static std::uint64_t bucket_value(std::size_t index)
+		{
+			if (index < SUB_BUCKET_COUNT)
+				return index;
+
+			std::size_t shift = index / SUB_BUCKET_COUNT - 1;
+			std::uint64_t sub = index % SUB_BUCKET_COUNT;
+			std::uint64_t lowest = (SUB_BUCKET_COUNT + sub) << shift;
+
+			return lowest + (((std::uint64_t)1 << shift) - 1);
+		}
+
+	protected:
+		struct alignas(64) stripe
+		{
+			std::atomic<std::uint64_t> count{ 0 };
+			std::atomic<std::uint64_t> sum{ 0 };
+			std::atomic<std::uint64_t> min{ (std::numeric_limits<std::uint64_t>::max)() };
+			std::atomic<std::uint64_t> max{ 0 };
+		};
+
+		/// every thread picks a stripe by round robin when it first records,and keeps using it
+		static std::size_t _index()
+		{
+			static std::atomic<std::size_t> next{ 0 };
+			static thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % STRIPE_COUNT;
+			return index;
+		}
+
+	private:
+		/// no copy construct function
+		histogram(const histogram&) = delete;
+
+		/// no operator equal function
+		histogram& operator=(const histogram&) = delete;
+
+	protected:
+
+		stripe m_stripes[STRIPE_COUNT];
+
+		std::atomic<std::uint64_t> m_buckets[BUCKET_COUNT];
+	};
+
+	inline std::uint64_t histogram_snapshot::percentile(double percentile) const
+	{
+		if (count == 0)
+			return 0;
+
+		if (percentile < 0)
+			percentile = 0;
+		if (percentile > 100)
+			percentile = 100;
+
+		std::uint64_t rank = (std::uint64_t)(percentile / 100.0 * (double)count + 0.5);
+		if (rank < 1)
+			rank = 1;
+
+		std::uint64_t total = 0;
+		for (std::size_t i = 0; i < buckets.size(); i++)
+		{
+			total += buckets[i];
+			if (total >= rank)
+			{
+				std::uint64_t value = histogram::bucket_value(i);
+				return (value < max ? value : max);
+			}
+		}
+
+		return max;
+	}
+
+}
@@ -0,0 +1,177 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ * referenced from : http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace zdb2
+{
+
+	/**
+	 * bounded multi producer multi consumer lock free queue based on std::atomic.
+	 * every cell carries a sequence number,so a cell can't be reused by a stale
+	 * producer or consumer (no ABA problem),and push/pop never take a lock.
+	 */
+	template<typename T>
+	class mpmc_queue
+	{
+	public:
+		explicit mpmc_queue(std::size_t capacity)
+		{
+			// the capacity must be a power of 2,so we can use mask instead of modulo
+			std::size_t size = 2;
+			while (size < capacity)
+				size <<= 1;
+
+			m_mask = size - 1;
+			m_cells.reset(new cell[size]);
+
+			for (std::size_t i = 0; i < size; i++)
+			{
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			m_enqueue_pos.store(0, std::memory_order_relaxed);
+			m_dequeue_pos.store(0, std::memory_order_relaxed);
+		}
+
+		~mpmc_queue()
+		{
+		}
+
+		/**
+		 * push a element into the queue tail.
+		 * @return false if the queue is full
+		 */
+		bool try_push(const T & data)
+		{
+			cell * c = nullptr;
+			std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				c = &m_cells[pos & m_mask];
+				std::size_t seq = c->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+				if (dif == 0)
+				{
+					if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (dif < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = m_enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			c->data = data;
+			c->sequence.store(pos + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		/**
+		 * pop a element from the queue head.
+		 * @return false if the queue is empty
+		 */
+		bool try_pop(T & data)
+		{
+			cell * c = nullptr;
+			std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				c = &m_cells[pos & m_mask];
+				std::size_t seq = c->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+				if (dif == 0)
+				{
+					if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (dif < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = m_dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			data = c->data;
+			c->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		/**
+		 * approximate element count,it is only a snapshot when other threads are pushing or popping.
+		 */
+		std::size_t size()
+		{
+			std::size_t head = m_dequeue_pos.load(std::memory_order_acquire);
+			std::size_t tail = m_enqueue_pos.load(std::memory_order_acquire);
+			return (tail > head ? tail - head : 0);
+		}
+
+		bool empty()
+		{
+			return (size() == 0);
+		}
+
+		std::size_t capacity()
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		/// no copy construct function
+		mpmc_queue(const mpmc_queue&) = delete;
+
+		/// no operator equal function
+		mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+	private:
+
+		struct cell
+		{
+			std::atomic<std::size_t> sequence;
+			T data;
+		};
+
+		/// pad to cache line size,avoid the enqueue and dequeue position sharing one cache line
+		typedef char cacheline_pad_t[64];
+
+		cacheline_pad_t m_pad0;
+
+		std::unique_ptr<cell[]> m_cells;
+
+		std::size_t m_mask = 0;
+
+		cacheline_pad_t m_pad1;
+
+		std::atomic<std::size_t> m_enqueue_pos;
+
+		cacheline_pad_t m_pad2;
+
+		std::atomic<std::size_t> m_dequeue_pos;
+
+		cacheline_pad_t m_pad3;
+	};
+
+}
@@ -0,0 +1,304 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ * the shard is referenced from : Correct and Efficient Work-Stealing for Weak Memory Models,Le,Pop,Cohen,Nardelli
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+#include <zdb2/util/mpmc_queue.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * a group of lock free bounded deques,every thread is bound to a shard,push into its own shard,
+	 * and pop from its own shard first,steal from the neighbour shards only when its own shard is
+	 * empty,so the threads on different cores don't bounce the same cache lines.
+	 * the own shard is popped LIFO,so a thread gets back the element it released last,which is still
+	 * hot in the cache of its core,the neighbour shards are stolen from FIFO,so the stealer takes the
+	 * coldest element and leaves the hot ones to the threads of that shard.
+	 * every shard is a bounded Chase-Lev deque,the stealers take the top by a CAS.The bottom is used
+	 * by one thread at a time,a thread takes it by a try flag,and when another thread of the same shard
+	 * holds it,the thread pushes into the next shard or steals instead of waiting,and when all of them
+	 * are held,the element goes to a shared lock free overflow queue,so no call ever waits or sleeps.
+	 * every shard has the capacity of the whole group,so a push never fails because one shard is full.
+	 * the elements must be trivially copyable,eg : pointers.
+	 */
+	template<typename T>
+	class sharded_queue
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "the element must be trivially copyable.");
+
+	public:
+		sharded_queue(std::size_t shard_count, std::size_t capacity) : m_overflow(capacity)
+		{
+			if (shard_count < 1)
+				shard_count = 1;
+
+			for (std::size_t i = 0; i < shard_count; i++)
+			{
+				m_shards.emplace_back(new shard(capacity));
+			}
+		}
+
+		~sharded_queue()
+		{
+		}
+
+		/**
+		 * push a element into the shard of the caller thread.
+		 * @return false if all the shards are full
+		 */
+		bool try_push(const T & data)
+		{
+			std::size_t index = _local_index();
+			bool busy = false;
+			for (std::size_t i = 0; i < m_shards.size(); i++)
+			{
+				int result = m_shards[(index + i) % m_shards.size()]->push_back(data);
+				if (result == shard::done)
+					return true;
+				busy = busy || (result == shard::busy);
+			}
+
+			// the shards which are not full are used by other threads,which may be preempted,so don't
+			// wait for them
+			return (busy && m_overflow.try_push(data));
+		}
+
+		/**
+		 * pop the newest element of the shard of the caller thread,or steal the oldest one of the
+		 * neighbour shards.
+		 * @return false if all the shards are empty
+		 */
+		bool try_pop(T & data)
+		{
+			std::size_t index = _local_index();
+			do
+			{
+				if (m_shards[index]->pop_back(data) == shard::done)
+					return true;
+
+				// the own shard is empty or its bottom is used by another thread of the shard
+				for (std::size_t i = 0; i < m_shards.size(); i++)
+				{
+					if (m_shards[(index + i) % m_shards.size()]->pop_front(data))
+						return true;
+				}
+
+				if (m_overflow.try_pop(data))
+					return true;
+
+				// lost the race for the last elements to other threads,try again if there are more
+			} while (!empty());
+
+			return false;
+		}
+
+		/**
+		 * pop the oldest element of the shards,starting from the shard of the caller thread,it is used
+		 * to drop the coldest elements.
+		 * @return false if all the shards are empty
+		 */
+		bool try_pop_oldest(T & data)
+		{
+			std::size_t index = _local_index();
+			if (m_overflow.try_pop(data))
+				return true;
+
+			for (std::size_t i = 0; i < m_shards.size(); i++)
+			{
+				if (m_shards[(index + i) % m_shards.size()]->pop_front(data))
+					return true;
+			}
+			return false;
+		}
+
+		/**
+		 * approximate element count of all the shards.
+		 */
+		std::size_t size()
+		{
+			std::size_t count = m_overflow.size();
+			for (auto & s : m_shards)
+			{
+				count += s->size();
+			}
+			return count;
+		}
+
+		bool empty()
+		{
+			if (!m_overflow.empty())
+				return false;
+
+			for (auto & s : m_shards)
+			{
+				if (s->size() > 0)
+					return false;
+			}
+			return true;
+		}
+
+		std::size_t shard_count()
+		{
+			return m_shards.size();
+		}
+
+	protected:
+		/**
+		 * a bounded Chase-Lev deque,the newest element is at the bottom,the oldest is at the top.
+		 */
+		struct shard
+		{
+			enum { done, empty_or_full, busy };
+
+			explicit shard(std::size_t capacity)
+			{
+				// the capacity must be a power of 2,so we can use mask instead of modulo
+				std::size_t size = 2;
+				while (size < capacity)
+					size <<= 1;
+
+				mask = size - 1;
+				cells.reset(new std::atomic<T>[size]);
+			}
+
+			int push_back(const T & data)
+			{
+				if (owner.test_and_set(std::memory_order_acquire))
+					return busy;
+
+				std::int64_t b = bottom.load(std::memory_order_relaxed);
+				std::int64_t t = top.load(std::memory_order_acquire);
+				if (b - t > (std::int64_t)mask)
+				{
+					owner.clear(std::memory_order_release);
+					return empty_or_full;
+				}
+
+				cells[(std::size_t)b & mask].store(data, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				bottom.store(b + 1, std::memory_order_relaxed);
+
+				owner.clear(std::memory_order_release);
+				return done;
+			}
+
+			int pop_back(T & data)
+			{
+				// don't touch the bottom of a empty shard
+				if (size() == 0)
+					return empty_or_full;
+
+				if (owner.test_and_set(std::memory_order_acquire))
+					return busy;
+
+				int result = empty_or_full;
+
+				std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+				bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t t = top.load(std::memory_order_relaxed);
+
+				if (t <= b)
+				{
+					data = cells[(std::size_t)b & mask].load(std::memory_order_relaxed);
+					result = done;
+
+					// the last element,race with the stealers for it
+					if (t == b)
+					{
+						if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+							result = empty_or_full;
+						bottom.store(b + 1, std::memory_order_relaxed);
+					}
+				}
+				else
+				{
+					bottom.store(b + 1, std::memory_order_relaxed);
+				}
+
+				owner.clear(std::memory_order_release);
+				return result;
+			}
+
+			bool pop_front(T & data)
+			{
+				for (;;)
+				{
+					std::int64_t t = top.load(std::memory_order_acquire);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					std::int64_t b = bottom.load(std::memory_order_acquire);
+
+					if (t >= b)
+						return false;
+
+					data = cells[(std::size_t)t & mask].load(std::memory_order_relaxed);
+					if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+						return true;
+
+					// another thread took the top element first,try the next one
+				}
+			}
+
+			std::size_t size()
+			{
+				std::int64_t b = bottom.load(std::memory_order_relaxed);
+				std::int64_t t = top.load(std::memory_order_relaxed);
+				return (b > t ? (std::size_t)(b - t) : 0);
+			}
+
+			/// keep the indexes of the neighbour shards off this cache line
+			char head[64];
+
+			/// the stealers take the element at top
+			std::atomic<std::int64_t> top{ 0 };
+
+			/// the thread which holds the owner flag pushes and pops at bottom
+			std::atomic<std::int64_t> bottom{ 0 };
+			std::atomic_flag owner = ATOMIC_FLAG_INIT;
+
+			std::unique_ptr<std::atomic<T>[]> cells;
+			std::size_t mask = 0;
+
+			char tail[64];
+		};
+
+		/// every thread is bound to a shard by round robin when it first uses the queue
+		std::size_t _local_index()
+		{
+			static std::atomic<std::size_t> next{ 0 };
+			static thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+			return index % m_shards.size();
+		}
+
+	private:
+		/// no copy construct function
+		sharded_queue(const sharded_queue&) = delete;
+
+		/// no operator equal function
+		sharded_queue& operator=(const sharded_queue&) = delete;
+
+	protected:
+
+		std::vector<std::unique_ptr<shard>> m_shards;
+
+		/// the elements pushed while the bottoms of all the shards which are not full are used
+		mpmc_queue<T> m_overflow;
+	};
+
+}
@@ -0,0 +1,208 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <zdb2/util/sql_scanner.hpp>
+
+namespace zdb2
+{
+
+	/**
+	 * the fingerprint of a sql text,the statements which differ only in the literals,the placeholders,
+	 * the length of the IN lists and the count of the VALUES rows have the same fingerprint,eg :
+	 *     select * from t where id in (1,2,3) and name='a'  ->  select * from t where id in ( ... ) and name = ?
+	 *     insert into t values (1,'a'),(2,'b')               ->  insert into t values ( ... )
+	 * The comments are removed,the white spaces are collapsed,and the words are case insensitive.
+	 * hash don't allocate memory,it is cheap enough to run on every statement.
+	 */
+	class sql_fingerprint
+	{
+	public:
+		/**
+		 * Returns the 64 bits FNV-1a hash of the fingerprint of the sql.
+		 */
+		static std::uint64_t hash(const char * sql)
+		{
+			hash_sink sink;
+			_walk(sql, sink);
+			return sink.h;
+		}
+
+		/**
+		 * Returns the text of the fingerprint of the sql,the tokens are separated by one space.
+		 */
+		static std::string text(const char * sql)
+		{
+			text_sink sink;
+			_walk(sql, sink);
+			return std::move(sink.s);
+		}
+
+	protected:
+		struct hash_sink
+		{
+			std::uint64_t h = 14695981039346656037ULL;
+
+			void put(const char * data, std::size_t size, bool fold)
+			{
+				for (std::size_t i = 0; i < size; i++)
+				{
+					unsigned char c = (unsigned char)data[i];
+					h ^= (fold ? (unsigned char)std::tolower(c) : c);
+					h *= 1099511628211ULL;
+				}
+				// the separator of the tokens
+				h ^= 0xff;
+				h *= 1099511628211ULL;
+			}
+		};
+
+		struct text_sink
+		{
+			std::string s;
+
+			void put(const char * data, std::size_t size, bool)
+			{
+				if (!s.empty())
+					s += ' ';
+				s.append(data, size);
+			}
+		};
+
+		static bool _is_value(const sql_token & token)
+		{
+			return (token.type == sql_token_type::string || token.type == sql_token_type::number ||
+				token.type == sql_token_type::parameter);
+		}
+
+		/// a sign before a number is a part of the literal if it can't be a binary operator there
+		static bool _is_sign(const sql_token & token, const sql_token * prev, const sql_scanner & scanner)
+		{
+			if (!token.is('-') && !token.is('+'))
+				return false;
+			if (prev && (prev->type != sql_token_type::punct || prev->is(')')))
+				return false;
+
+			sql_scanner next = scanner;
+			sql_token t;
+			return (next.next(t) && t.type == sql_token_type::number);
+		}
+
+		/**
+		 * skip a list of literals after the '(' of IN,the scanner is moved to the ')' only if the list
+		 * is made of literals,so IN (SELECT ...) is kept.
+		 */
+		static bool _skip_in_list(sql_scanner & scanner)
+		{
+			sql_scanner next = scanner;
+			sql_token t;
+			const sql_token * prev = nullptr;
+			sql_token last;
+			bool empty = true;
+			while (next.next(t))
+			{
+				if (t.is(')'))
+				{
+					if (empty)
+						return false;
+					scanner = next;
+					return true;
+				}
+				if (_is_sign(t, prev, next))
+				{
+					next.next(t);
+				}
+				else if (!_is_value(t) && !t.is(','))
+				{
+					return false;
+				}
+				empty = false;
+				last = t;
+				prev = &last;
+			}
+			return false;
+		}
+
+		/**
+		 * skip the rows after the first '(' of VALUES,a row may contain any expression,the scanner is
+		 * moved to the ')' of the last row.
+		 */
+		static bool _skip_values_rows(sql_scanner & scanner)
+		{
+			sql_scanner next = scanner;
+			sql_token t;
+			int depth = 1;
+			while (next.next(t))
+			{
+				if (t.is('('))
+					depth++;
+				else if (t.is(')') && --depth == 0)
+				{
+					scanner = next;
+
+					// the next row
+					sql_scanner more = next;
+					if (more.next(t) && t.is(',') && more.next(t) && t.is('('))
+					{
+						next = more;
+						depth = 1;
+						continue;
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+		template<typename Sink>
+		static void _walk(const char * sql, Sink & sink)
+		{
+			sql_scanner scanner(sql);
+			sql_token token;
+			sql_token prev;
+			bool has_prev = false;
+
+			while (scanner.next(token))
+			{
+				if (_is_value(token) || _is_sign(token, (has_prev ? &prev : nullptr), scanner))
+				{
+					if (!_is_value(token))
+						scanner.next(token);
+					sink.put("?", 1, false);
+					token.type = sql_token_type::parameter;
+				}
+				else if (token.is('(') && has_prev && (prev.is("in") || prev.is("values")) &&
+					(prev.is("in") ? _skip_in_list(scanner) : _skip_values_rows(scanner)))
+				{
+					sink.put("(", 1, false);
+					sink.put("...", 3, false);
+					sink.put(")", 1, false);
+					token.type = sql_token_type::punct;
+					token.data = ")";
+					token.size = 1;
+				}
+				else
+				{
+					sink.put(token.data, token.size, token.type == sql_token_type::identifier);
+				}
+
+				prev = token;
+				has_prev = true;
+			}
+		}
+	};
+
+}
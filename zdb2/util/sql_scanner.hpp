@@ -0,0 +1,222 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace zdb2
+{
+
+	enum class sql_token_type
+	{
+		identifier,        ///< a bare word,a keyword or a name
+		quoted_identifier, ///< "name",`name` or [name]
+		string,            ///< 'text'
+		number,            ///< 123,1.5e3,0x1f
+		parameter,         ///< ?,:name,@name,$1
+		punct,             ///< one operator or separator character
+	};
+
+	struct sql_token
+	{
+		sql_token_type type = sql_token_type::punct;
+
+		const char * data = nullptr;
+		std::size_t size = 0;
+
+		/**
+		 * Returns true if the token is the word,case insensitive.
+		 */
+		bool is(const char * word) const
+		{
+			if (type != sql_token_type::identifier || std::strlen(word) != size)
+				return false;
+			for (std::size_t i = 0; i < size; i++)
+			{
+				if (std::tolower((unsigned char)data[i]) != std::tolower((unsigned char)word[i]))
+					return false;
+			}
+			return true;
+		}
+
+		bool is(char c) const
+		{
+			return (type == sql_token_type::punct && size == 1 && data[0] == c);
+		}
+
+		/**
+		 * Returns the name without the quotes in lower case.
+		 */
+		std::string name() const
+		{
+			const char * p = data;
+			std::size_t n = size;
+			if (type == sql_token_type::quoted_identifier && n >= 2)
+			{
+				p++;
+				n -= 2;
+			}
+			std::string s(p, n);
+			for (auto & c : s)
+				c = (char)std::tolower((unsigned char)c);
+			return s;
+		}
+	};
+
+	/**
+	 * a lexical scanner of the sql text,it splits the text into tokens and skips the white spaces and
+	 * the comments.it knows nothing about the grammar,it is used to find the tables of a statement
+	 * and to normalize the text.
+	 */
+	class sql_scanner
+	{
+	public:
+		explicit sql_scanner(const char * sql) : m_p(sql ? sql : "")
+		{
+		}
+
+		/**
+		 * Read the next token.
+		 * @return false if there are no more tokens
+		 */
+		bool next(sql_token & token)
+		{
+			_skip();
+
+			const char * begin = m_p;
+			char c = *m_p;
+
+			if (c == '\0')
+				return false;
+
+			if (std::isalpha((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80)
+			{
+				while (std::isalnum((unsigned char)*m_p) || *m_p == '_' || *m_p == '$' || (unsigned char)*m_p >= 0x80)
+					m_p++;
+				return _token(token, sql_token_type::identifier, begin);
+			}
+
+			if (std::isdigit((unsigned char)c) || (c == '.' && std::isdigit((unsigned char)m_p[1])))
+			{
+				if (c == '0' && (m_p[1] == 'x' || m_p[1] == 'X'))
+					m_p += 2;
+				while (std::isalnum((unsigned char)*m_p) || *m_p == '.' ||
+					((*m_p == '+' || *m_p == '-') && (m_p[-1] == 'e' || m_p[-1] == 'E')))
+					m_p++;
+				return _token(token, sql_token_type::number, begin);
+			}
+
+			switch (c)
+			{
+			case '\'':
+				_quoted('\'', true);
+				return _token(token, sql_token_type::string, begin);
+			case '"':
+				_quoted('"', true);
+				return _token(token, sql_token_type::quoted_identifier, begin);
+			case '`':
+				_quoted('`', false);
+				return _token(token, sql_token_type::quoted_identifier, begin);
+			case '[':
+				_quoted(']', false);
+				return _token(token, sql_token_type::quoted_identifier, begin);
+			case '?':
+				m_p++;
+				return _token(token, sql_token_type::parameter, begin);
+			case ':':
+			case '@':
+			case '$':
+				if (std::isalnum((unsigned char)m_p[1]) || m_p[1] == '_')
+				{
+					m_p++;
+					while (std::isalnum((unsigned char)*m_p) || *m_p == '_')
+						m_p++;
+					return _token(token, sql_token_type::parameter, begin);
+				}
+				break;
+			default:
+				break;
+			}
+
+			m_p++;
+			return _token(token, sql_token_type::punct, begin);
+		}
+
+	protected:
+		bool _token(sql_token & token, sql_token_type type, const char * begin)
+		{
+			token.type = type;
+			token.data = begin;
+			token.size = (std::size_t)(m_p - begin);
+			return true;
+		}
+
+		/// skip the white spaces,the -- and # line comments and the /* */ block comments
+		void _skip()
+		{
+			for (;;)
+			{
+				while (std::isspace((unsigned char)*m_p))
+					m_p++;
+
+				if ((m_p[0] == '-' && m_p[1] == '-') || m_p[0] == '#')
+				{
+					while (*m_p && *m_p != '\n')
+						m_p++;
+				}
+				else if (m_p[0] == '/' && m_p[1] == '*')
+				{
+					m_p += 2;
+					while (*m_p && !(m_p[0] == '*' && m_p[1] == '/'))
+						m_p++;
+					if (*m_p)
+						m_p += 2;
+				}
+				else
+				{
+					break;
+				}
+			}
+		}
+
+		/// the quote is escaped by doubling it,and by a backslash in the mysql strings
+		void _quoted(char quote, bool backslash)
+		{
+			m_p++;
+			while (*m_p)
+			{
+				if (backslash && *m_p == '\\' && m_p[1])
+				{
+					m_p += 2;
+				}
+				else if (*m_p == quote)
+				{
+					m_p++;
+					if (*m_p != quote)
+						return;
+					m_p++;
+				}
+				else
+				{
+					m_p++;
+				}
+			}
+		}
+
+	protected:
+
+		const char * m_p = nullptr;
+	};
+
+}
@@ -0,0 +1,78 @@
+/*
+ * COPYRIGHT (C) 2017, zhllxt
+ *
+ * Author   : zhllxt
+ * QQ       : 37792738
+ * Email    : 37792738@qq.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+namespace zdb2
+{
+
+	/**
+	 * a counter split into several cache line aligned cells,every thread adds to its own cell,so
+	 * the threads don't contend on one cache line,the load sums all the cells,so it is slower than
+	 * the add and is only a snapshot when other threads are adding.
+	 */
+	template<std::size_t N = 16>
+	class striped_counter
+	{
+	public:
+		striped_counter()
+		{
+			for (std::size_t i = 0; i < N; i++)
+			{
+				m_cells[i].value.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void add(std::uint64_t n = 1)
+		{
+			m_cells[_index()].value.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		std::uint64_t load() const
+		{
+			std::uint64_t sum = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				sum += m_cells[i].value.load(std::memory_order_relaxed);
+			}
+			return sum;
+		}
+
+	protected:
+		/// every thread picks a cell by round robin when it first adds,and keeps using it
+		static std::size_t _index()
+		{
+			static std::atomic<std::size_t> next{ 0 };
+			static thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % N;
+			return index;
+		}
+
+	private:
+		/// no copy construct function
+		striped_counter(const striped_counter&) = delete;
+
+		/// no operator equal function
+		striped_counter& operator=(const striped_counter&) = delete;
+
+	protected:
+
+		struct alignas(64) cell
+		{
+			std::atomic<std::uint64_t> value;
+		};
+
+		cell m_cells[N];
+	};
+
+}